@@ -1,14 +1,13 @@
 #version 450
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
+layout(location = 3) in mat4 _InstanceModel; //Per instance, see ew::InstanceBuffer
 
 out vec3 Normal;
 
-uniform mat4 _Model;
-
 void main(){
 	Normal = vNormal;
-	gl_Position = _Model * vec4(vPos, 1.0);
+	gl_Position = _InstanceModel * vec4(vPos, 1.0);
 	gl_Position.z*=-1.0;
 
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <ew/shader.h>
 #include <ew/ewMath/vec3.h>
 #include <ew/procGen.h>
+#include <ew/instanceBuffer.h>
 
 #include <bp/shader.h>
 #include <bp/transformations.h>
@@ -62,6 +63,7 @@ int main() {
 	ew::Mesh cubeMesh(ew::createCube(0.5f));
 
 	bp::Transform cubes[NUM_CUBES];
+	ew::InstanceBuffer cubeInstances;
 
 	cubes[0].position = ew::Vec3(-0.5f, 0.5f, 0.0f);
 	cubes[1].position = ew::Vec3(0.5f, 0.5f, 0.0f);
@@ -76,10 +78,13 @@ int main() {
 
 		shader.use();
 
+		//All cubes in one draw call
+		ew::Mat4 cubeModels[NUM_CUBES];
 		for (int i = 0; i < NUM_CUBES; i++) {
-			shader.setMat4("_Model", cubes[i].getModelMatrix());
-			cubeMesh.draw();
+			cubeModels[i] = cubes[i].getModelMatrix();
 		}
+		cubeInstances.update(cubeModels, NUM_CUBES);
+		cubeMesh.drawInstanced(cubeInstances, NUM_CUBES);
 
 		//Render UI
 		{
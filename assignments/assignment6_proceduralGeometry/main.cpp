@@ -92,11 +92,11 @@ int main() {
 	ew::MeshData sphereMeshData = bp::createSphere(sphereRadius, sphereSegments);
 	ew::MeshData torusMeshData = bp::createTorus(torusRings, torusRingsDivisions, torusInner, torusOuter);
 
-	//Create Mesh Renderer
-	ew::Mesh planeMesh(planeMeshData);
-	ew::Mesh cylinderMesh(cylinderMeshData);
-	ew::Mesh sphereMesh(sphereMeshData);
-	ew::Mesh torusMesh(torusMeshData);
+	//Create Mesh Renderer. These are regenerated from the UI, so their buffers are reused between loads
+	ew::Mesh planeMesh(planeMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
+	ew::Mesh cylinderMesh(cylinderMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
+	ew::Mesh sphereMesh(sphereMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
+	ew::Mesh torusMesh(torusMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
 
 	//Initialize transforms
 	ew::Transform cubeTransform;
@@ -134,7 +134,7 @@ int main() {
 		shader.setInt("_Texture", 0);
 		shader.setInt("_Mode", appSettings.shadingModeIndex);
 		shader.setVec3("_Color", appSettings.shapeColor);
-		shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
+		shader.setMat4("_ViewProjection", camera.ViewProjectionMatrix());
 
 		//Euler angels to forward vector
 		ew::Vec3 lightRot = appSettings.lightRotation * ew::DEG2RAD;
@@ -199,23 +199,26 @@ int main() {
 			ImGui::Text("Cylinder Controls");
 			ImGui::DragFloat3("Cylinder Scale", &cylinderTransform.scale.x, 0.1f);
 			ImGui::DragFloat3("Cylinder Transform", &cylinderTransform.position.x, 0.1f);
-			ImGui::DragInt("Cylinder Segments", &cylinderSegments, 0.1, 3.0, 1000000000.0);
-			cylinderMeshData = bp::createCylinder(cylinderHeight, cylinderRadius, cylinderSegments);
-			cylinderMesh.load(cylinderMeshData);
+			if (ImGui::DragInt("Cylinder Segments", &cylinderSegments, 0.1, 3.0, 1000000000.0)) {
+				cylinderMeshData = bp::createCylinder(cylinderHeight, cylinderRadius, cylinderSegments);
+				cylinderMesh.load(cylinderMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
+			}
 
 			ImGui::Text("Sphere Controls");
 			ImGui::DragFloat3("Sphere Scale", &sphereTransform.scale.x, 0.1f);
 			ImGui::DragFloat3("Sphere Transform", &sphereTransform.position.x, 0.1f);
-			ImGui::DragInt("Sphere Segments", &sphereSegments, 0.1, 3.0, 1000000000.0);
-			sphereMeshData = bp::createSphere(sphereRadius, sphereSegments);
-			sphereMesh.load(sphereMeshData);
+			if (ImGui::DragInt("Sphere Segments", &sphereSegments, 0.1, 3.0, 1000000000.0)) {
+				sphereMeshData = bp::createSphere(sphereRadius, sphereSegments);
+				sphereMesh.load(sphereMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
+			}
 
 			ImGui::Text("Plane Controls");
 			ImGui::DragFloat3("Plane Size", &planeTransform.scale.x, 0.1f);
 			ImGui::DragFloat3("Plane Transform", &planeTransform.position.x, 0.1f);
-			ImGui::DragInt("Plane Divisions", &planeDivisions, 0.1, 1.0, 1000000000.0);
-			planeMeshData = bp::createPlane(planeSize, planeDivisions);
-			planeMesh.load(planeMeshData);
+			if (ImGui::DragInt("Plane Divisions", &planeDivisions, 0.1, 1.0, 1000000000.0)) {
+				planeMeshData = bp::createPlane(planeSize, planeDivisions);
+				planeMesh.load(planeMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
+			}
 
 			ImGui::Text("Cube Controls");
 			ImGui::DragFloat3("Cube Size", &cubeTransform.scale.x, 0.1f);
@@ -224,10 +227,11 @@ int main() {
 			ImGui::Text("Torus Controls");
 			ImGui::DragFloat3("Torus Scale", &torusTransform.scale.x, 0.1f);
 			ImGui::DragFloat3("Torus Transform", &torusTransform.position.x, 0.1f);
-			ImGui::DragInt("Torus Ring Count", &torusRings, 0.1, 4.0, 1000000000.0);
-			torusRingsDivisions = torusRings;
-			torusMeshData = bp::createTorus(torusRings, torusRingsDivisions, torusInner, torusOuter);
-			torusMesh.load(torusMeshData);
+			if (ImGui::DragInt("Torus Ring Count", &torusRings, 0.1, 4.0, 1000000000.0)) {
+				torusRingsDivisions = torusRings;
+				torusMeshData = bp::createTorus(torusRings, torusRingsDivisions, torusInner, torusOuter);
+				torusMesh.load(torusMeshData, ew::VertexFormat::FLOAT32, ew::MeshUsage::DYNAMIC);
+			}
 			ImGui::End();
 
 			ImGui::Render();
@@ -5,6 +5,7 @@ in Surface{
 	vec2 UV;
 	vec3 WorldPosition;
 	vec3 WorldNormal;
+	vec4 Color; //Tint, white unless set per instance
 }fs_in;
 
 uniform sampler2D _Texture;
@@ -62,6 +63,6 @@ void main(){
 	}
 	vec3 color = ambient + finalLight;
 
-	vec4 textColor = texture(_Texture,fs_in.UV);
+	vec4 textColor = texture(_Texture,fs_in.UV) * fs_in.Color;
 	FragColor = vec4(textColor.rgb * color, textColor.a);
 }
\ No newline at end of file
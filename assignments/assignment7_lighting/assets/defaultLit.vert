@@ -7,15 +7,18 @@ out Surface{
 	vec2 UV;
 	vec3 WorldPosition;
 	vec3 WorldNormal;
+	vec4 Color;
 }vs_out;
 
 uniform mat4 _Model;
-uniform mat4 _ViewProjection;
+uniform mat4 _MVP; //_ViewProjection * _Model, computed once per object on the CPU
+uniform mat3 _NormalMatrix; //Inverse-transpose of _Model, correct under non-uniform scale
 
 void main(){
 	vs_out.UV = vUV;
 	vec4 vertPos4 = _Model * vec4(vPos, 1.0);
 	vs_out.WorldPosition = vec3(vertPos4) / vertPos4.w;
-	vs_out.WorldNormal = vec3(_Model * vec4(vNormal, 0.0));
-	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
-}
\ No newline at end of file
+	vs_out.WorldNormal = _NormalMatrix * vNormal;
+	vs_out.Color = vec4(1.0);
+	gl_Position = _MVP * vec4(vPos,1.0);
+}
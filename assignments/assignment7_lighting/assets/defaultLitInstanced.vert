@@ -0,0 +1,26 @@
+#version 450
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec2 vUV;
+//Per instance, see ew::InstanceBuffer
+layout(location = 3) in mat4 _InstanceModel;
+layout(location = 7) in mat3 _InstanceNormalMatrix;
+layout(location = 10) in vec4 _InstanceColor;
+
+out Surface{
+	vec2 UV;
+	vec3 WorldPosition;
+	vec3 WorldNormal;
+	vec4 Color;
+}vs_out;
+
+uniform mat4 _ViewProjection;
+
+void main(){
+	vs_out.UV = vUV;
+	vec4 vertPos4 = _InstanceModel * vec4(vPos, 1.0);
+	vs_out.WorldPosition = vec3(vertPos4) / vertPos4.w;
+	vs_out.WorldNormal = _InstanceNormalMatrix * vNormal;
+	vs_out.Color = _InstanceColor;
+	gl_Position = _ViewProjection * vertPos4;
+}
@@ -0,0 +1,40 @@
+#version 450
+//defaultLitInstanced.vert for meshes uploaded in a quantized ew::VertexFormat
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec2 vNormal; //Octahedral encoded
+layout(location = 2) in vec2 vUV;
+//Per instance, see ew::InstanceBuffer
+layout(location = 3) in mat4 _InstanceModel;
+layout(location = 7) in mat3 _InstanceNormalMatrix;
+layout(location = 10) in vec4 _InstanceColor;
+
+out Surface{
+	vec2 UV;
+	vec3 WorldPosition;
+	vec3 WorldNormal;
+	vec4 Color;
+}vs_out;
+
+uniform mat4 _ViewProjection;
+//See ew::SetQuantizationUniforms
+uniform vec3 _PositionOffset;
+uniform vec3 _PositionScale;
+uniform vec2 _UVOffset;
+uniform vec2 _UVScale;
+
+vec3 decodeNormal(vec2 e){
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
+
+void main(){
+	vec3 pos = _PositionOffset + vPos * _PositionScale;
+	vs_out.UV = _UVOffset + vUV * _UVScale;
+	vec4 vertPos4 = _InstanceModel * vec4(pos, 1.0);
+	vs_out.WorldPosition = vec3(vertPos4) / vertPos4.w;
+	vs_out.WorldNormal = _InstanceNormalMatrix * decodeNormal(vNormal);
+	vs_out.Color = _InstanceColor;
+	gl_Position = _ViewProjection * vertPos4;
+}
@@ -3,9 +3,8 @@ layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vUV;
 
-uniform mat4 _Model;
-uniform mat4 _ViewProjection;
+uniform mat4 _MVP; //_ViewProjection * _Model, computed once per object on the CPU
 
 void main(){
-	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
-}
\ No newline at end of file
+	gl_Position = _MVP * vec4(vPos,1.0);
+}
@@ -0,0 +1,16 @@
+#version 450
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec2 vUV;
+//Per instance, see ew::InstanceBuffer
+layout(location = 3) in mat4 _InstanceModel;
+layout(location = 10) in vec4 _InstanceColor;
+
+out vec4 Color;
+
+uniform mat4 _ViewProjection;
+
+void main(){
+	Color = _InstanceColor;
+	gl_Position = _ViewProjection * (_InstanceModel * vec4(vPos,1.0));
+}
@@ -14,9 +14,16 @@
 #include <ew/transform.h>
 #include <ew/camera.h>
 #include <ew/cameraController.h>
+#include <ew/culling.h>
+#include <ew/meshCache.h>
+#include <ew/instanceBuffer.h>
+#include <ew/geometryPool.h>
+#include <ew/bvh.h>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void resetCamera(ew::Camera& camera, ew::CameraController& cameraController);
+void addIfVisible(ew::DrawList* drawList, const ew::GeometryPool& pool, const ew::Frustum& frustum, size_t mesh, const ew::Mat4& model, const ew::Vec4& color, ew::CullStats* stats);
+int pickShape(GLFWwindow* window, const ew::Bvh* bvhs, ew::Transform* const* transforms, int count);
 
 int SCREEN_WIDTH = 1080;
 int SCREEN_HEIGHT = 720;
@@ -33,13 +40,20 @@ struct Material {
 	float shininess; //Shininess
 };
 
+void setLightingUniforms(const ew::Shader& shader, const Light* lights, int numLights, const Material& material, float lightIntensity);
+void buildSphereField(int count, std::vector<ew::Transform>* transforms, std::vector<ew::Vec4>* colors);
+
 const int MAX_LIGHTS = 4;
+const int MAX_INSTANCED_SPHERES = 100000;
+const int NUM_SHAPES = 4;
+const ew::Vec4 PICKED_COLOR = ew::Vec4(1.0f, 0.6f, 0.2f, 1.0f);
 
 float prevTime;
 ew::Vec3 bgColor = ew::Vec3(0.1f);
 
 ew::Camera camera;
 ew::CameraController cameraController;
+ew::CullStats cullStats;
 
 int main() {
 	printf("Initializing...");
@@ -72,23 +86,35 @@ int main() {
 	glCullFace(GL_BACK);
 	glEnable(GL_DEPTH_TEST);
 
-	ew::Shader lightShader("assets/unlit.vert", "assets/unlit.frag");
+	ew::Shader lightShader("assets/unlitInstanced.vert", "assets/unlitInstanced.frag");
 
-	ew::Shader shader("assets/defaultLit.vert", "assets/defaultLit.frag");
+	ew::Shader instancedShader("assets/defaultLitInstanced.vert", "assets/defaultLit.frag");
+	ew::Shader quantizedShader("assets/defaultLitInstancedQuantized.vert", "assets/defaultLit.frag");
 	unsigned int brickTexture = ew::loadTexture("assets/brick_color.jpg", GL_REPEAT, GL_LINEAR);
 
-	//Create cube
-	ew::Mesh cubeMesh(ew::createCube(1.0f));
-	ew::Mesh planeMesh(ew::createPlane(5.0f, 5.0f, 10));
-	ew::Mesh sphereMesh(ew::createSphere(0.5f, 64));
-	ew::Mesh cylinderMesh(ew::createCylinder(0.5f, 1.0f, 32));
-
-	ew::Mesh lightMesh[MAX_LIGHTS];
-
-	for (int i = 0; i < 4; i++)
-	{
-		lightMesh[i] = ew::createSphere(0.3f, 15);
-	}
+	//Create meshes. Generated meshes are cached in a meshCache folder under the working directory,
+	//so later launches map them from disk.
+	//Scene shapes share one geometry pool so they are all drawn by a single multi-draw call
+	ew::MeshCache meshCache("meshCache");
+	ew::GeometryPool geometryPool;
+	ew::DrawList drawList;
+	const size_t cubeMesh = meshCache.load(ew::MeshCacheKey("ew::createCube", { 1.0f }), &geometryPool, [] { return ew::createCube(1.0f); });
+	const size_t planeMesh = meshCache.load(ew::MeshCacheKey("ew::createPlane", { 5.0f, 5.0f, 10 }), &geometryPool, [] { return ew::createPlane(5.0f, 5.0f, 10); });
+	const size_t sphereMesh = meshCache.load(ew::MeshCacheKey("ew::createSphere", { 0.5f, 64 }), &geometryPool, [] { return ew::createSphere(0.5f, 64); });
+	const size_t cylinderMesh = meshCache.load(ew::MeshCacheKey("ew::createCylinder", { 0.5f, 1.0f, 32 }), &geometryPool, [] { return ew::createCylinder(0.5f, 1.0f, 32); });
+
+	//Every light shares one mesh, drawn once per light by instancing
+	ew::Mesh lightMesh;
+	meshCache.load(ew::MeshCacheKey("ew::createSphere", { 0.3f, 15 }), &lightMesh, [] { return ew::createSphere(0.3f, 15); });
+	ew::InstanceBuffer lightInstances;
+
+	//Field of small spheres drawn with a single instanced call. Stored as 12 byte COMPACT vertices
+	ew::Mesh smallSphereMesh;
+	meshCache.load(ew::MeshCacheKey("ew::createSphere", { 0.1f, 8 }), &smallSphereMesh, [] { return ew::createSphere(0.1f, 8); }, ew::VertexFormat::COMPACT);
+	ew::InstanceBuffer sphereFieldInstances;
+	std::vector<ew::Transform> sphereFieldTransforms;
+	std::vector<ew::Vec4> sphereFieldColors;
+	int numInstancedSpheres = 0;
 
 	//Initialize transforms
 	ew::Transform cubeTransform;
@@ -100,6 +126,17 @@ int main() {
 	sphereTransform.position = ew::Vec3(-1.5f, 0.0f, 0.0f);
 	cylinderTransform.position = ew::Vec3(1.5f, 0.0f, 0.0f);
 
+	//Shapes the mouse can pick, tested on the CPU against a bvh of each mesh in model space
+	const char* shapeNames[NUM_SHAPES] = { "Cube", "Plane", "Sphere", "Cylinder" };
+	ew::Transform* shapeTransforms[NUM_SHAPES] = { &cubeTransform, &planeTransform, &sphereTransform, &cylinderTransform };
+	ew::Bvh shapeBvhs[NUM_SHAPES];
+	shapeBvhs[0].build(ew::createCube(1.0f));
+	shapeBvhs[1].build(ew::createPlane(5.0f, 5.0f, 10));
+	shapeBvhs[2].build(ew::createSphere(0.5f, 64));
+	shapeBvhs[3].build(ew::createCylinder(0.5f, 1.0f, 32));
+	int pickedShape = -1;
+	bool wasMouseDown = false;
+
 	Light lights[MAX_LIGHTS];
 
 	for (int i = 0; i < MAX_LIGHTS; i++)
@@ -149,54 +186,59 @@ int main() {
 		camera.aspectRatio = (float)SCREEN_WIDTH / SCREEN_HEIGHT;
 		cameraController.Move(window, &camera, deltaTime);
 
+		//Left click picks the nearest shape under the cursor
+		const bool mouseDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1) == GLFW_PRESS;
+		if (mouseDown && !wasMouseDown && !ImGui::GetIO().WantCaptureMouse) {
+			pickedShape = pickShape(window, shapeBvhs, shapeTransforms, NUM_SHAPES);
+		}
+		wasMouseDown = mouseDown;
+
 		//RENDER
 		glClearColor(bgColor.x, bgColor.y, bgColor.z, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		shader.use();
+		instancedShader.use();
 
 		glBindTexture(GL_TEXTURE_2D, brickTexture);
-		shader.setInt("_Texture", 0);
-		shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
-
-		for (int i = 0; i < numLights; i++)
-		{
-			shader.setVec3("_Lights[" + std::to_string(i) + "].position", lights[i].position);
-			shader.setVec3("_Lights[" + std::to_string(i) + "].color", lights[i].color);
+		instancedShader.setInt("_Texture", 0);
+		const ew::Mat4& viewProjection = camera.ViewProjectionMatrix();
+		instancedShader.setMat4("_ViewProjection", viewProjection);
+
+		setLightingUniforms(instancedShader, lights, numLights, material, lightIntensity);
+
+		//Draw shapes, skipping any outside the view frustum
+		const ew::Frustum& frustum = camera.GetFrustum();
+		cullStats.reset();
+		drawList.clear();
+		const size_t shapeMeshes[NUM_SHAPES] = { cubeMesh, planeMesh, sphereMesh, cylinderMesh };
+		for (int i = 0; i < NUM_SHAPES; i++) {
+			const ew::Vec4 color = i == pickedShape ? PICKED_COLOR : ew::Vec4(1.0f);
+			addIfVisible(&drawList, geometryPool, frustum, shapeMeshes[i], shapeTransforms[i]->getModelMatrix(), color, &cullStats);
+		}
+		drawList.submit(geometryPool);
+
+		if (sphereFieldInstances.getCount() > 0) {
+			quantizedShader.use();
+			quantizedShader.setInt("_Texture", 0);
+			quantizedShader.setMat4("_ViewProjection", viewProjection);
+			setLightingUniforms(quantizedShader, lights, numLights, material, lightIntensity);
+			ew::SetQuantizationUniforms(quantizedShader, smallSphereMesh.getQuantization());
+			smallSphereMesh.drawInstanced(sphereFieldInstances, sphereFieldInstances.getCount());
 		}
 
-		shader.setVec3("camPos", camera.position);
-
-		//Draw shapes
-		shader.setMat4("_Model", cubeTransform.getModelMatrix());
-		cubeMesh.draw();
-
-		shader.setMat4("_Model", planeTransform.getModelMatrix());
-		planeMesh.draw();
-
-		shader.setMat4("_Model", sphereTransform.getModelMatrix());
-		sphereMesh.draw();
-
-		shader.setMat4("_Model", cylinderTransform.getModelMatrix());
-		cylinderMesh.draw();
-
-		shader.setFloat("shininess", material.shininess);
-		shader.setFloat("ambient", material.ambientK);
-		shader.setFloat("specular", material.specular);
-		shader.setFloat("diffuse", material.diffuseK);
-		shader.setInt("numLights", numLights);
-		shader.setFloat("lightIntensity", lightIntensity);
-
-		//TODO: Render point lights
-
-		lightShader.use();
-
-		for (int i = 0; i < numLights; i++)
-		{
-			lightShader.setMat4("_Model", lightTransform[i].getModelMatrix());
-			lightShader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
-			lightShader.setVec3("_Color", lights[i].color);
-			lightMesh[i].draw();
+		//Point lights, one draw call for all of them
+		if (numLights > 0) {
+			ew::InstanceData lightData[MAX_LIGHTS];
+			for (int i = 0; i < numLights; i++)
+			{
+				lightData[i].model = lightTransform[i].getModelMatrix();
+				lightData[i].normalMatrix = ew::NormalMatrix(lightData[i].model);
+				lightData[i].color = ew::Vec4(lights[i].color.x, lights[i].color.y, lights[i].color.z, 1.0f);
+			}
+			lightInstances.update(lightData, numLights);
+			lightShader.use();
+			lightShader.setMat4("_ViewProjection", viewProjection);
+			lightMesh.drawInstanced(lightInstances, numLights);
 		}
 
 		//Render UI
@@ -220,6 +262,7 @@ int main() {
 				ImGui::DragFloat("Far Plane", &camera.farPlane, 0.1f, 0.0f);
 				ImGui::DragFloat("Move Speed", &cameraController.moveSpeed, 0.1f);
 				ImGui::DragFloat("Sprint Speed", &cameraController.sprintMoveSpeed, 0.1f);
+				ImGui::Text("Visible objects: %d / %d", (int)cullStats.visible, (int)cullStats.tested);
 				if (ImGui::Button("Reset")) {
 					resetCamera(camera, cameraController);
 				}
@@ -248,6 +291,19 @@ int main() {
 				}
 			}
 
+			if (ImGui::CollapsingHeader("Picking")) {
+				ImGui::Text("Left click a shape to pick it");
+				ImGui::Text("Picked: %s", pickedShape >= 0 ? shapeNames[pickedShape] : "None");
+			}
+
+			if (ImGui::CollapsingHeader("Instancing")) {
+				//Only rebuilt when the count changes, the instances are static otherwise
+				if (ImGui::SliderInt("Instanced Spheres", &numInstancedSpheres, 0, MAX_INSTANCED_SPHERES)) {
+					buildSphereField(numInstancedSpheres, &sphereFieldTransforms, &sphereFieldColors);
+					sphereFieldInstances.update(sphereFieldTransforms, sphereFieldColors);
+				}
+			}
+
 			ImGui::ColorEdit3("BG color", &bgColor.x);
 
 			ImGui::End();
@@ -279,4 +335,65 @@ void resetCamera(ew::Camera& camera, ew::CameraController& cameraController) {
 
 	cameraController.yaw = 0.0f;
 	cameraController.pitch = 0.0f;
+}
+
+void setLightingUniforms(const ew::Shader& shader, const Light* lights, int numLights, const Material& material, float lightIntensity) {
+	for (int i = 0; i < numLights; i++)
+	{
+		shader.setVec3("_Lights[" + std::to_string(i) + "].position", lights[i].position);
+		shader.setVec3("_Lights[" + std::to_string(i) + "].color", lights[i].color);
+	}
+	shader.setVec3("camPos", camera.position);
+	shader.setFloat("shininess", material.shininess);
+	shader.setFloat("ambient", material.ambientK);
+	shader.setFloat("specular", material.specular);
+	shader.setFloat("diffuse", material.diffuseK);
+	shader.setInt("numLights", numLights);
+	shader.setFloat("lightIntensity", lightIntensity);
+}
+
+//Square grid of count spheres just above the plane, colored by position
+void buildSphereField(int count, std::vector<ew::Transform>* transforms, std::vector<ew::Vec4>* colors) {
+	const float spacing = 0.25f;
+	const int side = (int)ceilf(sqrtf((float)count));
+	transforms->resize(count);
+	colors->resize(count);
+	for (int i = 0; i < count; i++) {
+		const int x = i % side;
+		const int z = i / side;
+		ew::Transform& transform = (*transforms)[i];
+		transform.position = ew::Vec3((x - side * 0.5f) * spacing, -0.9f, (z - side * 0.5f) * spacing);
+		(*colors)[i] = ew::Vec4((float)x / side, 0.5f, (float)z / side, 1.0f);
+	}
+}
+
+//Adds mesh to the draw list unless its transformed bounds are outside the frustum
+void addIfVisible(ew::DrawList* drawList, const ew::GeometryPool& pool, const ew::Frustum& frustum, size_t mesh, const ew::Mat4& model, const ew::Vec4& color, ew::CullStats* stats) {
+	stats->tested++;
+	if (!ew::IsVisible(frustum, ew::TransformAABB(pool.getBounds(mesh), model))) {
+		return;
+	}
+	stats->visible++;
+	drawList->add(pool, mesh, model, color);
+}
+
+//Index of the nearest shape under the cursor, or -1 if there is none
+int pickShape(GLFWwindow* window, const ew::Bvh* bvhs, ew::Transform* const* transforms, int count) {
+	double mouseX, mouseY;
+	int width, height;
+	glfwGetCursorPos(window, &mouseX, &mouseY);
+	glfwGetWindowSize(window, &width, &height);
+	const float ndcX = (float)(mouseX / width) * 2.0f - 1.0f;
+	const float ndcY = 1.0f - (float)(mouseY / height) * 2.0f;
+	const ew::Ray ray = ew::ScreenPointToRay(camera.InverseViewProjectionMatrix(), ndcX, ndcY);
+	int picked = -1;
+	ew::RayHit hit;
+	for (int i = 0; i < count; i++) {
+		//Each shape is tested in its model space, where hit distances match the world space ray
+		const ew::Ray localRay = ew::TransformRay(ray, ew::AffineInverse(transforms[i]->getModelMatrix()));
+		if (bvhs[i].intersect(localRay, &hit, hit.t)) {
+			picked = i;
+		}
+	}
+	return picked;
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+	Times Mat4 * Mat4 and Mat4 * Vec4 on the SIMD backend this binary was built for.
+	Run the _scalar, _sse and _avx builds one after another to compare them.
+*/
+
+#include <ew/ewMath/ewMath.h>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+//Operands stay in L1, so this measures the kernels rather than memory
+static const size_t NUM_MATRICES = 1024;
+static const int REPEATS = 1000;
+static const int RUNS = 20;
+
+//Fastest of RUNS runs of func, in milliseconds
+template <typename Func>
+static double bestTime(Func func) {
+	double best = 1e30;
+	for (int run = 0; run < RUNS; run++) {
+		const auto start = std::chrono::steady_clock::now();
+		func();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = ms < best ? ms : best;
+	}
+	return best;
+}
+
+int main() {
+	std::vector<ew::Mat4> a(NUM_MATRICES), b(NUM_MATRICES), products(NUM_MATRICES);
+	std::vector<ew::Vec4> v(NUM_MATRICES), transformed(NUM_MATRICES);
+	for (size_t i = 0; i < NUM_MATRICES; i++) {
+		for (int col = 0; col < 4; col++) {
+			for (int row = 0; row < 4; row++) {
+				a[i][col][row] = (float)(i + col * 4 + row) * 1e-3f;
+				b[i][col][row] = (float)(col - row) * 0.5f;
+			}
+		}
+		v[i] = ew::Vec4((float)i, 1.0f, 2.0f, 1.0f);
+	}
+
+	//Pairs are rotated each repeat so the compiler can't hoist the products out of the loop
+	const double mat4Mat4 = bestTime([&]() {
+		for (int r = 0; r < REPEATS; r++) {
+			for (size_t i = 0; i < NUM_MATRICES; i++) {
+				products[i] = a[(i + r) % NUM_MATRICES] * b[i];
+			}
+		}
+	});
+	const double mat4Vec4 = bestTime([&]() {
+		for (int r = 0; r < REPEATS; r++) {
+			for (size_t i = 0; i < NUM_MATRICES; i++) {
+				transformed[i] = a[(i + r) % NUM_MATRICES] * v[i];
+			}
+		}
+	});
+
+	//Printed so the results are used
+	float checksum = 0.0f;
+	for (size_t i = 0; i < NUM_MATRICES; i++) {
+		checksum += products[i][1][2] + transformed[i].y;
+	}
+	printf("Backend: %s\n", ew::SimdBackendName());
+	printf("%zu products per test, best of %d runs\n", NUM_MATRICES * REPEATS, RUNS);
+	printf("Mat4 * Mat4: %.2f ms\n", mat4Mat4);
+	printf("Mat4 * Vec4: %.2f ms\n", mat4Vec4);
+	printf("Checksum: %g\n", checksum);
+	return 0;
+}
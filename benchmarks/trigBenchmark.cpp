@@ -0,0 +1,101 @@
+/*
+	Times FastSinCos against sinf/cosf on the SIMD backend this binary was built for,
+	and reports how far the fast versions are from double precision sin/cos.
+*/
+
+#include <ew/ewMath/fastTrig.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+//About 8 MB of angles, sines and cosines, so timings include streaming them through the cache
+static const size_t NUM_ANGLES = 1 << 20;
+static const float MAX_ANGLE = 100.0f;
+static const int RUNS = 20;
+
+//Fastest of RUNS runs of func, in milliseconds
+template <typename Func>
+static double bestTime(Func func) {
+	double best = 1e30;
+	for (int run = 0; run < RUNS; run++) {
+		const auto start = std::chrono::steady_clock::now();
+		func();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = ms < best ? ms : best;
+	}
+	return best;
+}
+
+//Largest difference from double precision sin/cos
+static double maxError(const std::vector<float>& x, const std::vector<float>& s, const std::vector<float>& c) {
+	double worst = 0.0;
+	for (size_t i = 0; i < x.size(); i++) {
+		const double sinError = fabs(s[i] - sin((double)x[i]));
+		const double cosError = fabs(c[i] - cos((double)x[i]));
+		worst = sinError > worst ? sinError : worst;
+		worst = cosError > worst ? cosError : worst;
+	}
+	return worst;
+}
+
+//Largest difference between two runs over the same angles
+static float maxDifference(const std::vector<float>& a, const std::vector<float>& b) {
+	float worst = 0.0f;
+	for (size_t i = 0; i < a.size(); i++) {
+		const float difference = fabsf(a[i] - b[i]);
+		worst = difference > worst ? difference : worst;
+	}
+	return worst;
+}
+
+int main() {
+	//Shuffled across [-MAX_ANGLE, MAX_ANGLE] so branches on the quadrant can't be predicted
+	std::vector<float> x(NUM_ANGLES);
+	for (size_t i = 0; i < NUM_ANGLES; i++) {
+		x[i] = MAX_ANGLE * (2.0f * (float)((i * 2654435761u) % NUM_ANGLES) / NUM_ANGLES - 1.0f);
+	}
+	std::vector<float> libS(NUM_ANGLES), libC(NUM_ANGLES);
+	std::vector<float> scalarS(NUM_ANGLES), scalarC(NUM_ANGLES);
+	std::vector<float> packet4S(NUM_ANGLES), packet4C(NUM_ANGLES);
+	std::vector<float> packet8S(NUM_ANGLES), packet8C(NUM_ANGLES);
+
+	const double lib = bestTime([&]() {
+		for (size_t i = 0; i < NUM_ANGLES; i++) {
+			libS[i] = sinf(x[i]);
+			libC[i] = cosf(x[i]);
+		}
+	});
+	const double scalar = bestTime([&]() {
+		for (size_t i = 0; i < NUM_ANGLES; i++) {
+			ew::FastSinCos(x[i], &scalarS[i], &scalarC[i]);
+		}
+	});
+	const double packet4 = bestTime([&]() {
+		for (size_t i = 0; i < NUM_ANGLES; i += ew::Float4::WIDTH) {
+			ew::Float4 s, c;
+			ew::FastSinCos(ew::Float4::Load(&x[i]), &s, &c);
+			s.store(&packet4S[i]);
+			c.store(&packet4C[i]);
+		}
+	});
+	const double packet8 = bestTime([&]() {
+		for (size_t i = 0; i < NUM_ANGLES; i += ew::Float8::WIDTH) {
+			ew::Float8 s, c;
+			ew::FastSinCos(ew::Float8::Load(&x[i]), &s, &c);
+			s.store(&packet8S[i]);
+			c.store(&packet8C[i]);
+		}
+	});
+
+	printf("Backend: %s\n", ew::SimdBackendName());
+	printf("%zu angles in [-%g, %g], best of %d runs\n", NUM_ANGLES, MAX_ANGLE, MAX_ANGLE, RUNS);
+	printf("sinf + cosf:         %6.2f ms, max error %.3g\n", lib, maxError(x, libS, libC));
+	printf("FastSinCos scalar:   %6.2f ms, max error %.3g\n", scalar, maxError(x, scalarS, scalarC));
+	printf("FastSinCos Float4:   %6.2f ms, max error %.3g\n", packet4, maxError(x, packet4S, packet4C));
+	printf("FastSinCos Float8:   %6.2f ms, max error %.3g\n", packet8, maxError(x, packet8S, packet8C));
+	//Nonzero when the compiler fuses the scalar multiply-adds, e.g. with FMA enabled and -ffp-contract=fast
+	printf("Scalar vs Float4 max difference: %.3g\n", maxDifference(scalarS, packet4S) > maxDifference(scalarC, packet4C)
+		? maxDifference(scalarS, packet4S) : maxDifference(scalarC, packet4C));
+	return 0;
+}
@@ -1,38 +1,67 @@
 #include "procGen.h"
+#include "../ew/parallel.h"
+#include "../ew/ringTable.h"
+
+//Rows are independent and write to fixed offsets, so large meshes split them across threads
+static const size_t MIN_ELEMENTS_PER_THREAD = ew::DEFAULT_MIN_CHUNK;
+
+//Empty rows, e.g. 0 segments, count as one
+static size_t minRowsPerThread(size_t rowLength)
+{
+	return rowLength == 0 || rowLength >= MIN_ELEMENTS_PER_THREAD ? 1 : MIN_ELEMENTS_PER_THREAD / rowLength;
+}
+
+ew::MeshSize bp::getSphereSize(int numSegments)
+{
+	size_t columns = numSegments + 1;
+	return ew::MeshSize{ columns * columns, (size_t)numSegments * 6 + (size_t)numSegments * numSegments * 6 };
+}
 
 ew::MeshData bp::createSphere(float radius, int numSegments)
 {
-	ew::MeshData sphere;
-	ew::Vertex v;
+	ew::MeshData sphere = ew::AllocateMeshData(getSphereSize(numSegments));
+	createSphere(radius, numSegments, sphere.vertices.data(), sphere.indices.data());
+	return sphere;
+}
 
+void bp::createSphere(float radius, int numSegments, ew::Vertex* vertices, unsigned int* indices)
+{
 	float thetaStep = (2 * ew::PI) / numSegments;
 	float phiStep = ew::PI / numSegments;
-	float theta, phi;
-
-	for (int row = 0; row <= numSegments; row++)
-	{
-		phi = row * phiStep;
+	int columns = numSegments + 1;
 
-		for (int col = 0; col <= numSegments; col++)
+	//Column angles come from a table shared by every row, 8 vertices are emitted at a time
+	ew::ParallelFor(0, numSegments + 1, minRowsPerThread(columns), [&](size_t rowBegin, size_t rowEnd) {
+		ew::RingTable ring;
+		for (size_t colBegin = 0; colBegin < columns; colBegin += ew::RingTable::CAPACITY)
 		{
-			theta = col * thetaStep;
-			v.pos = ew::Vec3(radius * sin(phi) * sin(theta), radius * cos(phi), radius * sin(phi) * cos(theta));
-			v.normal = ew::Normalize(v.pos);
-			v.uv.x = (float)(col) / numSegments;
-			v.uv.y = (float)(row) / numSegments;
-			sphere.vertices.push_back(v);
+			ring.compute(thetaStep, colBegin, columns - colBegin);
+			for (int row = rowBegin; row < rowEnd; row++)
+			{
+				float phi = row * phiStep;
+				ew::Float8 sinPhi(sinf(phi));
+				ew::Float8 cosPhi(cosf(phi));
+				ew::Float8 uvY((float)(row) / numSegments);
+				ew::Vertex* v = vertices + row * columns + colBegin;
+
+				for (size_t i = 0; i < ring.count; i += ew::Float8::WIDTH)
+				{
+					ew::Vec3x8 normal(sinPhi * ew::Float8::Load(ring.sinA + i), cosPhi, sinPhi * ew::Float8::Load(ring.cosA + i));
+					ew::Float8 u = ew::LaneRamp<ew::Float8>((float)(colBegin + i)) / ew::Float8((float)numSegments);
+					ew::StoreVertices(v + i, ring.count - i, normal * ew::Float8(radius), normal, u, uvY);
+				}
+			}
 		}
-	}
+	});
 
 	int poleStart = 0;
 	int sideStart = numSegments + 1;
-	int columns = numSegments + 1;
 
 	for (int i = 0; i < numSegments; i++)
 	{
-		sphere.indices.push_back(poleStart + i);
-		sphere.indices.push_back(sideStart + i);
-		sphere.indices.push_back(sideStart + i + 1);
+		*indices++ = poleStart + i;
+		*indices++ = sideStart + i;
+		*indices++ = sideStart + i + 1;
 	}
 
 	poleStart = numSegments * (numSegments + 1);
@@ -40,100 +69,112 @@ ew::MeshData bp::createSphere(float radius, int numSegments)
 
 	for (int i = 0; i < numSegments; i++)
 	{
-		sphere.indices.push_back(sideStart + i);
-		sphere.indices.push_back(poleStart + i + 1);
-		sphere.indices.push_back(sideStart + i + 1);
+		*indices++ = sideStart + i;
+		*indices++ = poleStart + i + 1;
+		*indices++ = sideStart + i + 1;
 	}
 
-	for (int row = 0; row < numSegments; row++)
-	{
-		for (int col = 0; col < numSegments; col++)
+	ew::ParallelFor(0, numSegments, minRowsPerThread(numSegments), [&](size_t rowBegin, size_t rowEnd) {
+		unsigned int* index = indices + rowBegin * numSegments * 6;
+		for (int row = rowBegin; row < rowEnd; row++)
 		{
-			int start = row * columns + col;
-			//Triangle 1
-			sphere.indices.push_back(start);
-			sphere.indices.push_back(start + columns);
-			sphere.indices.push_back(start + 1);
-			//Triangle 2
-			sphere.indices.push_back(start + 1);
-			sphere.indices.push_back(start + columns);
-			sphere.indices.push_back(start + columns + 1);
+			for (int col = 0; col < numSegments; col++)
+			{
+				int start = row * columns + col;
+				//Triangle 1
+				*index++ = start;
+				*index++ = start + columns;
+				*index++ = start + 1;
+				//Triangle 2
+				*index++ = start + 1;
+				*index++ = start + columns;
+				*index++ = start + columns + 1;
+			}
 		}
+	});
+}
+
+ew::MeshSize bp::getCylinderSize(int numSegments)
+{
+	//Two centers and four rings, a triangle per segment on each cap and a quad per segment on the side
+	return ew::MeshSize{ (size_t)(numSegments + 1) * 4 + 2, (size_t)numSegments * 12 };
+}
+
+//Cylinder cap ring, 8 vertices at a time
+static void createCapRing(ew::Vertex* vertices, const ew::RingTable& ring, float radius, float y, float normalY)
+{
+	ew::Float8 half(0.5f), one(1.0f);
+	for (size_t i = 0; i < ring.count; i += ew::Float8::WIDTH)
+	{
+		ew::Float8 cosA = ew::Float8::Load(ring.cosA + i);
+		ew::Float8 sinA = ew::Float8::Load(ring.sinA + i);
+		ew::Vec3x8 pos(cosA * ew::Float8(radius), ew::Float8(y), sinA * ew::Float8(radius));
+		ew::StoreVertices(vertices + i, ring.count - i, pos, ew::Vec3x8(ew::Vec3(0, normalY, 0)), (sinA + one) * half, (cosA + one) * half);
 	}
+}
 
-	return sphere;
+//Cylinder side ring starting at column first, 8 vertices at a time
+static void createSideRing(ew::Vertex* vertices, const ew::RingTable& ring, size_t first, float radius, int numSegments, float y, float uvY)
+{
+	for (size_t i = 0; i < ring.count; i += ew::Float8::WIDTH)
+	{
+		ew::Float8 cosA = ew::Float8::Load(ring.cosA + i);
+		ew::Float8 sinA = ew::Float8::Load(ring.sinA + i);
+		ew::Vec3x8 pos(cosA * ew::Float8(radius), ew::Float8(y), sinA * ew::Float8(radius));
+		ew::Float8 u = ew::LaneRamp<ew::Float8>((float)(first + i)) / ew::Float8((float)numSegments);
+		ew::StoreVertices(vertices + i, ring.count - i, pos, ew::Vec3x8(cosA, ew::Float8(0.0f), sinA), u, ew::Float8(uvY));
+	}
 }
 
 ew::MeshData bp::createCylinder(float height, float radius, int numSegments)
 {
-	ew::MeshData cylinder;
+	ew::MeshData cylinder = ew::AllocateMeshData(getCylinderSize(numSegments));
+	createCylinder(height, radius, numSegments, cylinder.vertices.data(), cylinder.indices.data());
+	return cylinder;
+}
+
+void bp::createCylinder(float height, float radius, int numSegments, ew::Vertex* vertices, unsigned int* indices)
+{
 	ew::Vertex v;
 
 	float topY = height / 2, bottomY = -topY;
 	float thetaStep = (2 * ew::PI) / numSegments;
-	float u, vTop, vBottom;
+	int columns = numSegments + 1;
 
 	//Top Center
 	v.pos = ew::Vec3(0, topY, 0);
 	v.normal = ew::Vec3(0, 1, 0);
 	v.uv = ew::Vec2(0.5f, 0.5f);
-	cylinder.vertices.push_back(v);
-
-	//Top Ring (Top Face)
-	for (int i = 0; i <= numSegments; i++)
-	{
-		float theta = i * thetaStep;
-		v.pos = ew::Vec3(cos(theta) * radius, topY, sin(theta) * radius);
-		v.normal = ew::Vec3(0, 1, 0);
-		v.uv = ew::Vec2((sin(theta) + 1) / 2, (cos(theta) + 1) / 2);
-		cylinder.vertices.push_back(v);
-	}
+	vertices[0] = v;
 
 	//Bottom Center
 	v.pos = ew::Vec3(0, bottomY, 0);
 	v.normal = ew::Vec3(0, -1, 0);
 	v.uv = ew::Vec2(0.5f, 0.5f);
-	cylinder.vertices.push_back(v);
+	vertices[columns + 1] = v;
 
-	//Bottom Ring (Bottom Face)
-	for (int i = 0; i <= numSegments; i++)
-	{
-		float theta = i * thetaStep;
-		v.pos = ew::Vec3(cos(theta) * radius, bottomY, sin(theta) * radius);
-		v.normal = ew::Vec3(0, -1, 0);
-		v.uv = ew::Vec2((sin(theta) + 1) / 2, (cos(theta) + 1) / 2);
-		cylinder.vertices.push_back(v);
-	}
+	ew::Vertex* topFace = vertices + 1;
+	ew::Vertex* bottomFace = topFace + columns + 1;
+	ew::Vertex* topSide = bottomFace + columns;
+	ew::Vertex* bottomSide = topSide + columns;
 
-	//
-	// Top Ring (Side Face)
-	for (int i = 0; i <= numSegments; i++)
+	//All four rings share one table of angles
+	ew::RingTable ring;
+	for (size_t first = 0; first < columns; first += ew::RingTable::CAPACITY)
 	{
-		float theta = i * thetaStep;
-		v.pos = ew::Vec3(cos(theta) * radius, topY, sin(theta) * radius);
-		v.normal = ew::Normalize(ew::Vec3(cos(theta), 0, sin(theta)));
-		u = float(i) / numSegments;
-		v.uv = ew::Vec2(u, 1);
-		cylinder.vertices.push_back(v);
-	}
-
-	//Bottom Ring (Side Face)
-	for (int i = 0; i <= numSegments; i++)
-	{
-		float theta = i * thetaStep;
-		v.pos = ew::Vec3(cos(theta) * radius, bottomY, sin(theta) * radius);
-		v.normal = ew::Normalize(ew::Vec3(cos(theta), 0, sin(theta)));
-		u = float(i) / numSegments;;
-		v.uv = ew::Vec2(u, 0);
-		cylinder.vertices.push_back(v);
+		ring.compute(thetaStep, first, columns - first);
+		createCapRing(topFace + first, ring, radius, topY, 1.0f);
+		createCapRing(bottomFace + first, ring, radius, bottomY, -1.0f);
+		createSideRing(topSide + first, ring, first, radius, numSegments, topY, 1.0f);
+		createSideRing(bottomSide + first, ring, first, radius, numSegments, bottomY, 0.0f);
 	}
 
 	//Cap Indices
 	int start = 1, center = 0;
 	for (int i = 0; i < numSegments; i++) {
-		cylinder.indices.push_back(start + i);
-		cylinder.indices.push_back(center);
-		cylinder.indices.push_back(start + i + 1);
+		*indices++ = start + i;
+		*indices++ = center;
+		*indices++ = start + i + 1;
 	}
 
 	start += numSegments + 2;
@@ -141,112 +182,151 @@ ew::MeshData bp::createCylinder(float height, float radius, int numSegments)
 
 	for (int i = 0; i < numSegments; i++) {
 
-		cylinder.indices.push_back(center);
-		cylinder.indices.push_back(start + i);
-		cylinder.indices.push_back(start + i + 1);
+		*indices++ = center;
+		*indices++ = start + i;
+		*indices++ = start + i + 1;
 	}
 	start = 1;
 
-	int sideStart = 2 * (numSegments + 1) + 2, columns = numSegments + 1;
+	int sideStart = 2 * (numSegments + 1) + 2;
 	for (int i = 0; i < numSegments; i++)
 	{
 		start = sideStart + i;
 
 		//Triangle 1
-		cylinder.indices.push_back(start);
-		cylinder.indices.push_back(start + 1);
-		cylinder.indices.push_back(start + columns);
+		*indices++ = start;
+		*indices++ = start + 1;
+		*indices++ = start + columns;
 		//Triangle 2
-		cylinder.indices.push_back(start + columns);
-		cylinder.indices.push_back(start + 1);
-		cylinder.indices.push_back(start + columns + 1);
+		*indices++ = start + columns;
+		*indices++ = start + 1;
+		*indices++ = start + columns + 1;
 	}
+}
 
-	return cylinder;
+ew::MeshSize bp::getPlaneSize(int subdivisions)
+{
+	size_t columns = subdivisions + 1;
+	return ew::MeshSize{ columns * columns, (size_t)subdivisions * subdivisions * 6 };
 }
 
 ew::MeshData bp::createPlane(float size, int subdivisions)
 {
-	ew::MeshData plane;
-	ew::Vertex v;
+	ew::MeshData plane = ew::AllocateMeshData(getPlaneSize(subdivisions));
+	createPlane(size, subdivisions, plane.vertices.data(), plane.indices.data());
+	return plane;
+}
+
+void bp::createPlane(float size, int subdivisions, ew::Vertex* vertices, unsigned int* indices)
+{
+	int columns = subdivisions + 1;
 
 	//Vertices
-	for (int row = 0; row <= subdivisions; row++)
-	{
-		for (int col = 0; col <= subdivisions; col++)
+	ew::ParallelFor(0, subdivisions + 1, minRowsPerThread(columns), [&](size_t rowBegin, size_t rowEnd) {
+		ew::Vec3x8 normal(ew::Vec3(0, 1, 0));
+		for (int row = rowBegin; row < rowEnd; row++)
 		{
-			v.pos = ew::Vec3(size * ((float)col / subdivisions), 0, -size * ((float)row / subdivisions));
-			v.normal = ew::Vec3(0, 1, 0);
-			v.uv = ew::Vec2(1 - (float)row / subdivisions, (float)col / subdivisions);
-			plane.vertices.push_back(v);
+			ew::Float8 posZ(-size * ((float)row / subdivisions));
+			ew::Float8 uvX(1 - (float)row / subdivisions);
+			ew::Vertex* v = vertices + row * columns;
+
+			//8 vertices at a time
+			for (int col = 0; col < columns; col += ew::Float8::WIDTH)
+			{
+				ew::Float8 t = ew::LaneRamp<ew::Float8>((float)col) / ew::Float8((float)subdivisions);
+				ew::Vec3x8 pos(ew::Float8(size) * t, ew::Float8(0.0f), posZ);
+				ew::StoreVertices(v + col, columns - col, pos, normal, uvX, t);
+			}
 		}
-	}
+	});
 
 	//Indices
-	int columns = subdivisions + 1;
-
-	for (int row = 0; row < subdivisions; row++)
-	{
-		for (int col = 0; col < subdivisions; col++)
+	ew::ParallelFor(0, subdivisions, minRowsPerThread(subdivisions), [&](size_t rowBegin, size_t rowEnd) {
+		unsigned int* index = indices + rowBegin * subdivisions * 6;
+		for (int row = rowBegin; row < rowEnd; row++)
 		{
-			int start = row * columns + col;
-
-			//Bottom Right Triangle
-			plane.indices.push_back(start);
-			plane.indices.push_back(start + 1);
-			plane.indices.push_back(start + columns + 1);
-
-			//Top Left Triangle
-			plane.indices.push_back(start);
-			plane.indices.push_back(start + columns + 1);
-			plane.indices.push_back(start + columns);
+			for (int col = 0; col < subdivisions; col++)
+			{
+				int start = row * columns + col;
+
+				//Bottom Right Triangle
+				*index++ = start;
+				*index++ = start + 1;
+				*index++ = start + columns + 1;
+
+				//Top Left Triangle
+				*index++ = start;
+				*index++ = start + columns + 1;
+				*index++ = start + columns;
+			}
 		}
-	}
+	});
+}
 
-	return plane;
+ew::MeshSize bp::getTorusSize(int outerSegments, int innerSegments)
+{
+	//Index loop runs over innerSegments + 1 columns, so the last column wraps into the next ring
+	return ew::MeshSize{ (size_t)(outerSegments + 1) * (innerSegments + 1), (size_t)outerSegments * (innerSegments + 1) * 6 };
 }
 
 ew::MeshData bp::createTorus(int outerSegments, int innerSegments, float outerRadius, float innerRadius)
 {
-	ew::MeshData torus;
-	ew::Vertex v;
+	ew::MeshData torus = ew::AllocateMeshData(getTorusSize(outerSegments, innerSegments));
+	createTorus(outerSegments, innerSegments, outerRadius, innerRadius, torus.vertices.data(), torus.indices.data());
+	return torus;
+}
 
+void bp::createTorus(int outerSegments, int innerSegments, float outerRadius, float innerRadius, ew::Vertex* vertices, unsigned int* indices)
+{
 	//Ring Radius
-	float phi = 0.0, deltaPhi = (2 * ew::PI) / outerSegments;
+	float deltaPhi = (2 * ew::PI) / outerSegments;
 	//Torus Radius
-	float theta = 0.0, deltaTheta = (2 * ew::PI) / innerSegments;
-
-	//Vertices
-	for (int i = 0; i <= outerSegments; i++)
-	{
-		phi = i * deltaPhi;
-		for (int j = 0; j <= innerSegments; j++)
+	float deltaTheta = (2 * ew::PI) / innerSegments;
+	int columns = innerSegments + 1;
+
+	//Vertices, one ring per row
+	//Theta comes from a table shared by every ring, 8 vertices are emitted at a time
+	ew::ParallelFor(0, outerSegments + 1, minRowsPerThread(columns), [&](size_t ringBegin, size_t ringEnd) {
+		ew::RingTable table;
+		for (size_t colBegin = 0; colBegin < columns; colBegin += ew::RingTable::CAPACITY)
 		{
-			theta = j * deltaTheta;
-			v.pos.x = cos(theta) * (outerRadius + cos(phi) * innerRadius);
-			v.pos.y = sin(theta) * (outerRadius + cos(phi) * innerRadius);
-			v.pos.z = sin(phi) * innerRadius;
-			v.normal = ew::Normalize(v.pos);
-			v.uv.x = (float)(j) / innerSegments;
-			v.uv.y = (float)(i) / outerSegments;
-			torus.vertices.push_back(v);
+			table.compute(deltaTheta, colBegin, columns - colBegin);
+			for (int i = ringBegin; i < ringEnd; i++)
+			{
+				float phi = i * deltaPhi;
+				ew::Float8 ringRadius(outerRadius + cosf(phi) * innerRadius);
+				ew::Float8 posZ(sinf(phi) * innerRadius);
+				ew::Float8 uvY((float)(i) / outerSegments);
+				ew::Vertex* v = vertices + i * columns + colBegin;
+
+				for (size_t j = 0; j < table.count; j += ew::Float8::WIDTH)
+				{
+					ew::Vec3x8 pos(ew::Float8::Load(table.cosA + j) * ringRadius, ew::Float8::Load(table.sinA + j) * ringRadius, posZ);
+					//Normalized position, as before, rather than the surface normal
+					ew::Float8 length = ew::Magnitude(pos);
+					ew::Vec3x8 normal(pos.x / length, pos.y / length, pos.z / length);
+					ew::Float8 u = ew::LaneRamp<ew::Float8>((float)(colBegin + j)) / ew::Float8((float)innerSegments);
+					ew::StoreVertices(v + j, table.count - j, pos, normal, u, uvY);
+				}
+			}
 		}
-	}
+	});
 
 	//Indices
-	for (int i = 0; i <= outerSegments - 1; i++)
-	{
-		for (int j = 0; j <= innerSegments; j++)
+	ew::ParallelFor(0, outerSegments, minRowsPerThread(columns), [&](size_t ringBegin, size_t ringEnd) {
+		unsigned int* index = indices + ringBegin * columns * 6;
+		for (int i = ringBegin; i < ringEnd; i++)
 		{
-			torus.indices.push_back(i + ((j + 1) * innerSegments));
-			torus.indices.push_back(i + (j * innerSegments));
-			torus.indices.push_back((i + 1) + ((j + 1) * innerSegments));
-
-			torus.indices.push_back((i + 1) + ((j + 1) * innerSegments));
-			torus.indices.push_back(i + (j * innerSegments));
-			torus.indices.push_back((i + 1) + (j * innerSegments));
+			for (int j = 0; j <= innerSegments; j++)
+			{
+				*index++ = i + ((j + 1) * innerSegments);
+				*index++ = i + (j * innerSegments);
+				*index++ = (i + 1) + ((j + 1) * innerSegments);
+
+				*index++ = (i + 1) + ((j + 1) * innerSegments);
+				*index++ = i + (j * innerSegments);
+				*index++ = (i + 1) + (j * innerSegments);
+			}
 		}
-	}
-
-	return torus;
+	});
 }
\ No newline at end of file
@@ -5,4 +5,16 @@ namespace bp {
 	ew::MeshData createCylinder(float height, float radius, int numSegments);
 	ew::MeshData createPlane(float size, int subdivisions);
 	ew::MeshData createTorus(int ringCount, int ringSubDivisions, float outerRadius, float innerRadius);
-}
\ No newline at end of file
+
+	//Exact output sizes, for sizing the buffers passed to the overloads below
+	ew::MeshSize getSphereSize(int numSegments);
+	ew::MeshSize getCylinderSize(int numSegments);
+	ew::MeshSize getPlaneSize(int subdivisions);
+	ew::MeshSize getTorusSize(int ringCount, int ringSubDivisions);
+
+	//Write into caller owned buffers without allocating. Indices are relative to vertices[0]
+	void createSphere(float radius, int numSegments, ew::Vertex* vertices, unsigned int* indices);
+	void createCylinder(float height, float radius, int numSegments, ew::Vertex* vertices, unsigned int* indices);
+	void createPlane(float size, int subdivisions, ew::Vertex* vertices, unsigned int* indices);
+	void createTorus(int ringCount, int ringSubDivisions, float outerRadius, float innerRadius, ew::Vertex* vertices, unsigned int* indices);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <math.h>
+#include "procGen.h"
+#include "../ew/procLod.h"
+
+//Re-tessellatable shapes for ew::ProceduralLodCache
+namespace bp {
+	inline ew::ProceduralShape proceduralSphere(float radius) {
+		ew::ProceduralShape shape;
+		shape.radius = radius;
+		shape.curvatureRadius = radius;
+		shape.generate = [radius](int segments) { return createSphere(radius, segments); };
+		return shape;
+	}
+
+	inline ew::ProceduralShape proceduralCylinder(float height, float radius) {
+		ew::ProceduralShape shape;
+		shape.radius = sqrtf(radius * radius + height * height * 0.25f);
+		shape.curvatureRadius = radius;
+		shape.generate = [height, radius](int segments) { return createCylinder(height, radius, segments); };
+		return shape;
+	}
+
+	//segments divides the tube. The ring around the center gets enough segments for the same error at its outer edge
+	inline ew::ProceduralShape proceduralTorus(float outerRadius, float innerRadius) {
+		ew::ProceduralShape shape;
+		shape.radius = outerRadius + innerRadius;
+		shape.curvatureRadius = innerRadius;
+		shape.generate = [outerRadius, innerRadius](int segments) {
+			const int ringSegments = ew::ScaleSegments(segments, innerRadius, outerRadius + innerRadius);
+			//createTorus takes the tube's segments first and the ring's second
+			return createTorus(segments, ringSegments, outerRadius, innerRadius);
+		};
+		return shape;
+	}
+}
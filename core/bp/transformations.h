@@ -1,6 +1,7 @@
 #pragma once
 #include "../ew/ewMath/mat4.h"
 #include "../ew/ewMath/vec3.h"
+#include "../ew/ewMath/fastTrig.h"
 
 namespace bp {
 	const float CONVERT_TO_RADIANS = 3.14 / 180;
@@ -25,27 +26,33 @@ namespace bp {
 	};
 	//Rotation around X axis (pitch) in radians
 	inline ew::Mat4 RotateX(float rad) {
+		float sinA, cosA;
+		ew::FastSinCos(rad, &sinA, &cosA);
 		return ew::Mat4(
 			1, 0, 0, 0,
-			0, cos(rad), -sin(rad), 0,
-			0, sin(rad), cos(rad), 0,
+			0, cosA, -sinA, 0,
+			0, sinA, cosA, 0,
 			0, 0, 0, 1
 		);
 	};
 	//Rotation around Y axis (yaw) in radians
 	inline ew::Mat4 RotateY(float rad) {
+		float sinA, cosA;
+		ew::FastSinCos(rad, &sinA, &cosA);
 		return ew::Mat4(
-			cos(rad), 0, sin(rad), 0,
+			cosA, 0, sinA, 0,
 			0, 1, 0, 0,
-			-sin(rad), 0, cos(rad), 0,
+			-sinA, 0, cosA, 0,
 			0, 0, 0, 1
 		);
 	};
 	//Rotation around Z axis (roll) in radians
 	inline ew::Mat4 RotateZ(float rad) {
+		float sinA, cosA;
+		ew::FastSinCos(rad, &sinA, &cosA);
 		return ew::Mat4(
-			cos(rad), -sin(rad), 0, 0,
-			sin(rad), cos(rad), 0, 0,
+			cosA, -sinA, 0, 0,
+			sinA, cosA, 0, 0,
 			0, 0, 1, 0,
 			0, 0, 0, 1
 		);
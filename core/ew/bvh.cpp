@@ -0,0 +1,834 @@
+#include "bvh.h"
+#include <math.h>
+#include <algorithm>
+#include <mutex>
+#include "parallel.h"
+#include "ewMath/packet.h"
+
+namespace ew {
+	Ray ScreenPointToRay(const ew::Mat4& inverseViewProjection, float ndcX, float ndcY)
+	{
+		const ew::Vec4 nearPoint = inverseViewProjection * ew::Vec4(ndcX, ndcY, -1.0f, 1.0f);
+		const ew::Vec4 farPoint = inverseViewProjection * ew::Vec4(ndcX, ndcY, 1.0f, 1.0f);
+		Ray ray;
+		ray.origin = nearPoint.toVec3() / nearPoint.w;
+		ray.direction = ew::Normalize(farPoint.toVec3() / farPoint.w - ray.origin);
+		return ray;
+	}
+
+	Ray TransformRay(const Ray& ray, const ew::Mat4& m)
+	{
+		Ray out;
+		out.origin = (m * ew::Vec4(ray.origin, 1.0f)).toVec3();
+		out.direction = (m * ew::Vec4(ray.direction, 0.0f)).toVec3();
+		return out;
+	}
+
+	namespace {
+		const int NUM_BINS = 16;
+		//SAH cost of visiting a node, relative to testing one triangle
+		const float TRAVERSAL_COST = 1.0f;
+		//Ranges this small become leaves without binning, which would cost more than it saves
+		const uint32_t MIN_SPLIT_TRIANGLES = 2;
+		const size_t MIN_TRIANGLES_PER_THREAD = DEFAULT_MIN_CHUNK;
+		//Smallest subtree handed to a thread of its own
+		const size_t MIN_SUBTREE_TRIANGLES = 4096;
+		//Past this depth nodes are split at the median, which bounds the depth of degenerate inputs
+		const int MAX_SAH_DEPTH = 64;
+		//Median splits of up to 2^32 triangles add at most 32 levels, and a node pushes at most 4 children
+		const int STACK_SIZE = 4 * (MAX_SAH_DEPTH + 32);
+
+		inline AABB emptyBounds() {
+			AABB box;
+			box.min = ew::Vec3(FLT_MAX);
+			box.max = ew::Vec3(-FLT_MAX);
+			return box;
+		}
+		//Plain compares rather than fminf, which compiles to a call on some targets and dominates the build
+		inline float minf(float a, float b) { return a < b ? a : b; }
+		inline float maxf(float a, float b) { return a > b ? a : b; }
+		inline ew::Vec3 min3(const ew::Vec3& a, const ew::Vec3& b) { return ew::Vec3(minf(a.x, b.x), minf(a.y, b.y), minf(a.z, b.z)); }
+		inline ew::Vec3 max3(const ew::Vec3& a, const ew::Vec3& b) { return ew::Vec3(maxf(a.x, b.x), maxf(a.y, b.y), maxf(a.z, b.z)); }
+		inline void grow(AABB& box, const ew::Vec3& p) {
+			box.min = min3(box.min, p);
+			box.max = max3(box.max, p);
+		}
+		//Also correct for an empty other, which leaves box unchanged
+		inline void grow(AABB& box, const AABB& other) {
+			box.min = min3(box.min, other.min);
+			box.max = max3(box.max, other.max);
+		}
+		//Half the surface area, which is all SAH needs
+		inline float area(const AABB& box) {
+			const ew::Vec3 d = box.max - box.min;
+			return d.x < 0.0f ? 0.0f : d.x * d.y + d.y * d.z + d.z * d.x;
+		}
+		inline float component(const ew::Vec3& v, int axis) {
+			return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+		}
+
+		//Node of the binary tree SAH builds, collapsed into BvhNodes afterwards
+		struct BuildNode {
+			AABB bounds;
+			uint32_t left, right;
+			uint32_t first, count; //Leaf if count > 0
+		};
+
+		struct Bin {
+			AABB bounds = emptyBounds();
+			uint32_t count = 0;
+		};
+
+		inline int toBin(float scaled) {
+			const int b = (int)scaled;
+			return b < NUM_BINS ? b : NUM_BINS - 1;
+		}
+
+		//Triangles [first, first + count) of the build order, with the bounds of the triangles and of their centroids
+		struct BuildRange {
+			uint32_t first, count;
+			AABB bounds;
+			AABB centroidBounds;
+		};
+
+		class Builder {
+		public:
+			//Range left for a thread to build once the top of the tree is done
+			struct Subtree {
+				uint32_t node;
+				BuildRange range;
+				int depth;
+			};
+
+			Builder(const AABB* triangleBounds, const ew::Vec3* centroids, uint32_t* order, size_t subtreeSize)
+				:m_triangleBounds(triangleBounds), m_centroids(centroids), m_order(order), m_subtreeSize(subtreeSize) {}
+
+			BuildRange makeRange(uint32_t first, uint32_t count)const {
+				BuildRange range;
+				range.first = first;
+				range.count = count;
+				range.bounds = emptyBounds();
+				range.centroidBounds = emptyBounds();
+				std::mutex mutex;
+				ParallelFor(first, first + count, MIN_TRIANGLES_PER_THREAD, [&](size_t begin, size_t end) {
+					AABB bounds = emptyBounds(), centroidBounds = emptyBounds();
+					for (size_t i = begin; i < end; i++) {
+						grow(bounds, m_triangleBounds[m_order[i]]);
+						grow(centroidBounds, m_centroids[m_order[i]]);
+					}
+					std::lock_guard<std::mutex> lock(mutex);
+					grow(range.bounds, bounds);
+					grow(range.centroidBounds, centroidBounds);
+				});
+				return range;
+			}
+
+			//Builds the range into nodes and returns the index of its root. With defer set, ranges of at most
+			//subtreeSize triangles are left as empty nodes and recorded in subtrees instead
+			uint32_t build(std::vector<BuildNode>& nodes, const BuildRange& range, int depth, bool defer) {
+				const uint32_t index = (uint32_t)nodes.size();
+				nodes.push_back(BuildNode());
+				nodes[index].bounds = range.bounds;
+				if (defer && range.count <= m_subtreeSize) {
+					Subtree subtree = { index, range, depth };
+					subtrees.push_back(subtree);
+					return index;
+				}
+
+				BuildRange leftRange, rightRange;
+				if (!split(range, depth, &leftRange, &rightRange)) {
+					nodes[index].first = range.first;
+					nodes[index].count = range.count;
+					return index;
+				}
+				//Children are built before being stored, since building them can reallocate nodes
+				const uint32_t left = build(nodes, leftRange, depth + 1, defer);
+				const uint32_t right = build(nodes, rightRange, depth + 1, defer);
+				nodes[index].left = left;
+				nodes[index].right = right;
+				nodes[index].count = 0;
+				return index;
+			}
+
+			std::vector<Subtree> subtrees;
+
+		private:
+			//Reorders the range into the two given halves, or returns false to make it a leaf.
+			//SAH splits take the halves' bounds from the bins, so only median splits pass over the triangles again
+			bool split(const BuildRange& range, int depth, BuildRange* left, BuildRange* right)const {
+				if (range.count <= MIN_SPLIT_TRIANGLES) {
+					return false;
+				}
+				const uint32_t first = range.first;
+				const uint32_t count = range.count;
+				const ew::Vec3 extent = range.centroidBounds.max - range.centroidBounds.min;
+				const ew::Vec3 origin = range.centroidBounds.min;
+				int bestAxis = -1;
+				int bestPlane = 0;
+				float bestCost = FLT_MAX;
+				//Scaled slightly down, so the largest centroid still lands in the last bin
+				const float BIN_SCALE = NUM_BINS * (1.0f - 1e-5f);
+				const ew::Vec3 scale(extent.x > 0.0f ? BIN_SCALE / extent.x : 0.0f,
+					extent.y > 0.0f ? BIN_SCALE / extent.y : 0.0f,
+					extent.z > 0.0f ? BIN_SCALE / extent.z : 0.0f);
+				Bin bins[3][NUM_BINS];
+				if (depth < MAX_SAH_DEPTH) {
+					std::mutex mutex;
+					ParallelFor(first, first + count, MIN_TRIANGLES_PER_THREAD, [&](size_t begin, size_t end) {
+						Bin localBins[3][NUM_BINS];
+						for (size_t i = begin; i < end; i++) {
+							const uint32_t triangle = m_order[i];
+							const ew::Vec3& centroid = m_centroids[triangle];
+							const int b[3] = {
+								toBin((centroid.x - origin.x) * scale.x),
+								toBin((centroid.y - origin.y) * scale.y),
+								toBin((centroid.z - origin.z) * scale.z)
+							};
+							for (int axis = 0; axis < 3; axis++) {
+								Bin& bin = localBins[axis][b[axis]];
+								grow(bin.bounds, m_triangleBounds[triangle]);
+								bin.count++;
+							}
+						}
+						std::lock_guard<std::mutex> lock(mutex);
+						for (int axis = 0; axis < 3; axis++) {
+							for (int b = 0; b < NUM_BINS; b++) {
+								grow(bins[axis][b].bounds, localBins[axis][b].bounds);
+								bins[axis][b].count += localBins[axis][b].count;
+							}
+						}
+					});
+					for (int axis = 0; axis < 3; axis++) {
+						if (component(scale, axis) == 0.0f) {
+							continue;
+						}
+						//Sweep from the right, then test each plane while sweeping from the left
+						float rightArea[NUM_BINS];
+						uint32_t rightCount[NUM_BINS];
+						AABB box = emptyBounds();
+						uint32_t sum = 0;
+						for (int b = NUM_BINS - 1; b > 0; b--) {
+							grow(box, bins[axis][b].bounds);
+							sum += bins[axis][b].count;
+							rightArea[b] = area(box);
+							rightCount[b] = sum;
+						}
+						box = emptyBounds();
+						sum = 0;
+						for (int plane = 1; plane < NUM_BINS; plane++) {
+							grow(box, bins[axis][plane - 1].bounds);
+							sum += bins[axis][plane - 1].count;
+							if (sum == 0 || rightCount[plane] == 0) {
+								continue;
+							}
+							const float cost = area(box) * sum + rightArea[plane] * rightCount[plane];
+							if (cost < bestCost) {
+								bestCost = cost;
+								bestAxis = axis;
+								bestPlane = plane;
+							}
+						}
+					}
+				}
+				const float boundsArea = area(range.bounds);
+				const float splitCost = boundsArea > 0.0f ? TRAVERSAL_COST + bestCost / boundsArea : FLT_MAX;
+				if (bestAxis >= 0 && (splitCost < count || count > Bvh::MAX_LEAF_TRIANGLES)) {
+					const float axisOrigin = component(origin, bestAxis);
+					const float axisScale = component(scale, bestAxis);
+					*left = { first, 0, emptyBounds(), emptyBounds() };
+					*right = { 0, 0, emptyBounds(), emptyBounds() };
+					for (int b = 0; b < NUM_BINS; b++) {
+						grow(b < bestPlane ? left->bounds : right->bounds, bins[bestAxis][b].bounds);
+					}
+					//Partitions while growing each side's centroid bounds, which the bins don't track
+					uint32_t i = first;
+					uint32_t j = first + count;
+					while (i < j) {
+						const ew::Vec3& centroid = m_centroids[m_order[i]];
+						if (toBin((component(centroid, bestAxis) - axisOrigin) * axisScale) < bestPlane) {
+							grow(left->centroidBounds, centroid);
+							i++;
+						}
+						else {
+							grow(right->centroidBounds, centroid);
+							std::swap(m_order[i], m_order[--j]);
+						}
+					}
+					left->count = i - first;
+					right->first = i;
+					right->count = count - left->count;
+					return true;
+				}
+				if (count <= Bvh::MAX_LEAF_TRIANGLES) {
+					return false;
+				}
+				//No usable SAH split, e.g. all centroids in one spot, so split by count on the widest axis
+				const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+				const uint32_t half = count / 2;
+				std::nth_element(m_order + first, m_order + first + half, m_order + first + count, [&](uint32_t a, uint32_t b) {
+					return component(m_centroids[a], axis) < component(m_centroids[b], axis);
+				});
+				*left = makeRange(first, half);
+				*right = makeRange(first + half, count - half);
+				return true;
+			}
+
+			const AABB* m_triangleBounds;
+			const ew::Vec3* m_centroids;
+			uint32_t* m_order;
+			size_t m_subtreeSize;
+		};
+
+		//Writes the 4 wide node at out[outIndex] for binary node, by opening the inner child with the largest area
+		//until there are 4 children or only leaves
+		void collapse(const std::vector<BuildNode>& nodes, uint32_t node, std::vector<BvhNode>& out, uint32_t outIndex) {
+			uint32_t children[4];
+			int numChildren = 0;
+			if (nodes[node].count > 0) {
+				children[numChildren++] = node;
+			}
+			else {
+				children[numChildren++] = nodes[node].left;
+				children[numChildren++] = nodes[node].right;
+			}
+			while (numChildren < 4) {
+				int largest = -1;
+				float largestArea = -1.0f;
+				for (int i = 0; i < numChildren; i++) {
+					const BuildNode& child = nodes[children[i]];
+					if (child.count == 0 && area(child.bounds) > largestArea) {
+						largest = i;
+						largestArea = area(child.bounds);
+					}
+				}
+				if (largest < 0) {
+					break;
+				}
+				const BuildNode& opened = nodes[children[largest]];
+				children[largest] = opened.left;
+				children[numChildren++] = opened.right;
+			}
+
+			for (int i = 0; i < 4; i++) {
+				//Empty slots get inverted bounds, which no ray overlaps
+				const AABB bounds = i < numChildren ? nodes[children[i]].bounds : emptyBounds();
+				BvhNode& slot = out[outIndex];
+				slot.minX[i] = bounds.min.x;
+				slot.minY[i] = bounds.min.y;
+				slot.minZ[i] = bounds.min.z;
+				slot.maxX[i] = bounds.max.x;
+				slot.maxY[i] = bounds.max.y;
+				slot.maxZ[i] = bounds.max.z;
+				slot.child[i] = BvhNode::EMPTY;
+				slot.count[i] = 0;
+			}
+			for (int i = 0; i < numChildren; i++) {
+				const BuildNode& child = nodes[children[i]];
+				if (child.count > 0) {
+					out[outIndex].child[i] = child.first;
+					out[outIndex].count[i] = child.count;
+					continue;
+				}
+				const uint32_t childIndex = (uint32_t)out.size();
+				out[outIndex].child[i] = childIndex;
+				out.push_back(BvhNode());
+				collapse(nodes, children[i], out, childIndex);
+			}
+		}
+
+		//Reciprocal of the direction with zeros nudged away, so slab tests never compute 0 * infinity
+		inline ew::Vec3 safeInverse(const ew::Vec3& d) {
+			const float TINY = 1e-20f;
+			return ew::Vec3(
+				1.0f / (fabsf(d.x) > TINY ? d.x : copysignf(TINY, d.x)),
+				1.0f / (fabsf(d.y) > TINY ? d.y : copysignf(TINY, d.y)),
+				1.0f / (fabsf(d.z) > TINY ? d.z : copysignf(TINY, d.z)));
+		}
+
+		struct StackEntry {
+			uint32_t node;
+			float tNear;
+		};
+	}
+
+	void Bvh::clear()
+	{
+		m_nodes.clear();
+		m_triangles.clear();
+		m_triangleIds.clear();
+	}
+
+	void Bvh::build(const MeshData& meshData)
+	{
+		clear();
+		const size_t numTriangles = meshData.indices.size() / 3;
+		if (numTriangles == 0) {
+			return;
+		}
+		const Vertex* vertices = meshData.vertices.data();
+		const unsigned int* indices = meshData.indices.data();
+		std::vector<AABB> triangleBounds(numTriangles);
+		std::vector<ew::Vec3> centroids(numTriangles);
+		m_triangleIds.resize(numTriangles);
+		ParallelFor(0, numTriangles, MIN_TRIANGLES_PER_THREAD, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				AABB box = emptyBounds();
+				grow(box, vertices[indices[i * 3]].pos);
+				grow(box, vertices[indices[i * 3 + 1]].pos);
+				grow(box, vertices[indices[i * 3 + 2]].pos);
+				triangleBounds[i] = box;
+				centroids[i] = box.center();
+				m_triangleIds[i] = (uint32_t)i;
+			}
+		});
+
+		//The top of the tree is built here, with each split's binning spread across threads.
+		//Smaller subtrees below it are then built on threads of their own
+		const size_t subtreeSize = std::max(MIN_SUBTREE_TRIANGLES, numTriangles / (4 * GetWorkerCount()));
+		Builder builder(triangleBounds.data(), centroids.data(), m_triangleIds.data(), subtreeSize);
+		std::vector<BuildNode> nodes;
+		nodes.reserve(numTriangles * 2 / MAX_LEAF_TRIANGLES + 1);
+		builder.build(nodes, builder.makeRange(0, (uint32_t)numTriangles), 0, true);
+		std::vector<std::vector<BuildNode>> subtreeNodes(builder.subtrees.size());
+		ParallelFor(0, builder.subtrees.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const Builder::Subtree& subtree = builder.subtrees[i];
+				builder.build(subtreeNodes[i], subtree.range, subtree.depth, false);
+			}
+		});
+		//Each subtree's root replaces its placeholder, and the rest is appended with child indices shifted to match
+		for (size_t i = 0; i < subtreeNodes.size(); i++) {
+			const std::vector<BuildNode>& local = subtreeNodes[i];
+			const uint32_t offset = (uint32_t)nodes.size() - 1;
+			for (size_t n = 0; n < local.size(); n++) {
+				BuildNode node = local[n];
+				if (node.count == 0) {
+					node.left += offset;
+					node.right += offset;
+				}
+				if (n == 0) {
+					nodes[builder.subtrees[i].node] = node;
+				}
+				else {
+					nodes.push_back(node);
+				}
+			}
+		}
+
+		m_nodes.reserve(nodes.size() / 2 + 1);
+		m_nodes.push_back(BvhNode());
+		collapse(nodes, 0, m_nodes, 0);
+		updateTriangles(meshData);
+	}
+
+	void Bvh::updateTriangles(const MeshData& meshData)
+	{
+		const Vertex* vertices = meshData.vertices.data();
+		const unsigned int* indices = meshData.indices.data();
+		m_triangles.resize(m_triangleIds.size());
+		ParallelFor(0, m_triangles.size(), MIN_TRIANGLES_PER_THREAD, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const unsigned int* triangle = indices + m_triangleIds[i] * 3;
+				const ew::Vec3& v0 = vertices[triangle[0]].pos;
+				m_triangles[i].v0 = v0;
+				m_triangles[i].edge1 = vertices[triangle[1]].pos - v0;
+				m_triangles[i].edge2 = vertices[triangle[2]].pos - v0;
+			}
+		});
+	}
+
+	void Bvh::refit(const MeshData& meshData)
+	{
+		if (m_nodes.empty()) {
+			return;
+		}
+		updateTriangles(meshData);
+		const Vertex* vertices = meshData.vertices.data();
+		const unsigned int* indices = meshData.indices.data();
+		//Leaves only read triangles, so they are refit in parallel. Leaves hold few triangles, so chunks are by node
+		ParallelFor(0, m_nodes.size(), MIN_TRIANGLES_PER_THREAD / MAX_LEAF_TRIANGLES, [&](size_t begin, size_t end) {
+			for (size_t n = begin; n < end; n++) {
+				BvhNode& node = m_nodes[n];
+				for (int i = 0; i < 4; i++) {
+					if (node.count[i] == 0) {
+						continue;
+					}
+					AABB box = emptyBounds();
+					for (uint32_t t = node.child[i]; t < node.child[i] + node.count[i]; t++) {
+						const unsigned int* triangle = indices + m_triangleIds[t] * 3;
+						grow(box, vertices[triangle[0]].pos);
+						grow(box, vertices[triangle[1]].pos);
+						grow(box, vertices[triangle[2]].pos);
+					}
+					node.minX[i] = box.min.x; node.minY[i] = box.min.y; node.minZ[i] = box.min.z;
+					node.maxX[i] = box.max.x; node.maxY[i] = box.max.y; node.maxZ[i] = box.max.z;
+				}
+			}
+		});
+		//Children come after their parents, so walking backwards refits every child before its parent
+		for (size_t n = m_nodes.size(); n-- > 0;) {
+			BvhNode& node = m_nodes[n];
+			for (int i = 0; i < 4; i++) {
+				if (node.count[i] != 0 || node.child[i] == BvhNode::EMPTY) {
+					continue;
+				}
+				const BvhNode& child = m_nodes[node.child[i]];
+				AABB box = emptyBounds();
+				for (int c = 0; c < 4; c++) {
+					if (child.child[c] != BvhNode::EMPTY) {
+						grow(box, ew::Vec3(child.minX[c], child.minY[c], child.minZ[c]));
+						grow(box, ew::Vec3(child.maxX[c], child.maxY[c], child.maxZ[c]));
+					}
+				}
+				node.minX[i] = box.min.x; node.minY[i] = box.min.y; node.minZ[i] = box.min.z;
+				node.maxX[i] = box.max.x; node.maxY[i] = box.max.y; node.maxZ[i] = box.max.z;
+			}
+		}
+	}
+
+	AABB Bvh::getBounds() const
+	{
+		AABB bounds;
+		if (m_nodes.empty()) {
+			return bounds;
+		}
+		bounds = emptyBounds();
+		const BvhNode& root = m_nodes[0];
+		for (int i = 0; i < 4; i++) {
+			if (root.child[i] != BvhNode::EMPTY) {
+				grow(bounds, ew::Vec3(root.minX[i], root.minY[i], root.minZ[i]));
+				grow(bounds, ew::Vec3(root.maxX[i], root.maxY[i], root.maxZ[i]));
+			}
+		}
+		return bounds;
+	}
+
+	namespace {
+		//Single ray against the 4 children of node. Returns a bit mask of children hit before tMax
+		//and writes each child's entry distance to tNear
+		inline int intersectChildren(const BvhNode& node, const ew::Vec3& origin, const ew::Vec3& inverseDirection, float tMax, float* tNear) {
+			//Testing the near and far planes per direction sign, rather than min and max of both,
+			//also rejects the inverted bounds of empty children
+			const bool negX = inverseDirection.x < 0.0f, negY = inverseDirection.y < 0.0f, negZ = inverseDirection.z < 0.0f;
+			const Float4 ox(origin.x), oy(origin.y), oz(origin.z);
+			const Float4 ix(inverseDirection.x), iy(inverseDirection.y), iz(inverseDirection.z);
+			const Float4 nearX = (Float4::Load(negX ? node.maxX : node.minX) - ox) * ix;
+			const Float4 nearY = (Float4::Load(negY ? node.maxY : node.minY) - oy) * iy;
+			const Float4 nearZ = (Float4::Load(negZ ? node.maxZ : node.minZ) - oz) * iz;
+			const Float4 farX = (Float4::Load(negX ? node.minX : node.maxX) - ox) * ix;
+			const Float4 farY = (Float4::Load(negY ? node.minY : node.maxY) - oy) * iy;
+			const Float4 farZ = (Float4::Load(negZ ? node.minZ : node.maxZ) - oz) * iz;
+			const Float4 enter = Max(Max(nearX, nearY), Max(nearZ, Float4(0.0f)));
+			const Float4 exit = Min(Min(farX, farY), Min(farZ, Float4(tMax)));
+			enter.store(tNear);
+			return MoveMask(CmpLe(enter, exit));
+		}
+
+		//Moller-Trumbore. Written so NaNs from rays parallel to the triangle fail every test
+		inline bool intersectTriangle(const ew::Vec3& origin, const ew::Vec3& direction, const ew::Vec3& v0, const ew::Vec3& edge1, const ew::Vec3& edge2,
+			float tMax, float* t, float* u, float* v) {
+			const ew::Vec3 p = ew::Cross(direction, edge2);
+			const float inverseDet = 1.0f / ew::Dot(edge1, p);
+			const ew::Vec3 s = origin - v0;
+			*u = ew::Dot(s, p) * inverseDet;
+			if (!(*u >= 0.0f && *u <= 1.0f)) {
+				return false;
+			}
+			const ew::Vec3 q = ew::Cross(s, edge1);
+			*v = ew::Dot(direction, q) * inverseDet;
+			if (!(*v >= 0.0f && *u + *v <= 1.0f)) {
+				return false;
+			}
+			*t = ew::Dot(edge2, q) * inverseDet;
+			return *t >= 0.0f && *t < tMax;
+		}
+	}
+
+	bool Bvh::intersect(const Ray& ray, RayHit* hit, float tMax) const
+	{
+		if (m_nodes.empty()) {
+			return false;
+		}
+		const ew::Vec3 inverseDirection = safeInverse(ray.direction);
+		float closest = tMax;
+		uint32_t closestTriangle = RayHit::NO_HIT;
+		float closestU = 0.0f, closestV = 0.0f;
+		StackEntry stack[STACK_SIZE];
+		int stackSize = 0;
+		stack[stackSize++] = { 0, 0.0f };
+		while (stackSize > 0) {
+			const StackEntry entry = stack[--stackSize];
+			if (entry.tNear >= closest) {
+				continue;
+			}
+			const BvhNode& node = m_nodes[entry.node];
+			float tNear[4];
+			const int mask = intersectChildren(node, ray.origin, inverseDirection, closest, tNear);
+			//Inner children are pushed farthest first, so the nearest is visited next
+			StackEntry inner[4];
+			int numInner = 0;
+			for (int i = 0; i < 4; i++) {
+				if (!(mask & (1 << i))) {
+					continue;
+				}
+				if (node.count[i] == 0) {
+					int at = numInner++;
+					for (; at > 0 && inner[at - 1].tNear < tNear[i]; at--) {
+						inner[at] = inner[at - 1];
+					}
+					inner[at] = { node.child[i], tNear[i] };
+					continue;
+				}
+				for (uint32_t t = node.child[i]; t < node.child[i] + node.count[i]; t++) {
+					const Triangle& triangle = m_triangles[t];
+					float tHit, u, v;
+					if (intersectTriangle(ray.origin, ray.direction, triangle.v0, triangle.edge1, triangle.edge2, closest, &tHit, &u, &v)) {
+						closest = tHit;
+						closestTriangle = t;
+						closestU = u;
+						closestV = v;
+					}
+				}
+			}
+			for (int i = 0; i < numInner; i++) {
+				stack[stackSize++] = inner[i];
+			}
+		}
+		if (closestTriangle == RayHit::NO_HIT) {
+			return false;
+		}
+		hit->t = closest;
+		hit->triangle = m_triangleIds[closestTriangle];
+		hit->u = closestU;
+		hit->v = closestV;
+		return true;
+	}
+
+	bool Bvh::occluded(const Ray& ray, float tMax) const
+	{
+		if (m_nodes.empty()) {
+			return false;
+		}
+		const ew::Vec3 inverseDirection = safeInverse(ray.direction);
+		uint32_t stack[STACK_SIZE];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const BvhNode& node = m_nodes[stack[--stackSize]];
+			float tNear[4];
+			const int mask = intersectChildren(node, ray.origin, inverseDirection, tMax, tNear);
+			for (int i = 0; i < 4; i++) {
+				if (!(mask & (1 << i))) {
+					continue;
+				}
+				if (node.count[i] == 0) {
+					stack[stackSize++] = node.child[i];
+					continue;
+				}
+				for (uint32_t t = node.child[i]; t < node.child[i] + node.count[i]; t++) {
+					const Triangle& triangle = m_triangles[t];
+					float tHit, u, v;
+					if (intersectTriangle(ray.origin, ray.direction, triangle.v0, triangle.edge1, triangle.edge2, tMax, &tHit, &u, &v)) {
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	namespace {
+		//Packets are as wide as a native register. Without AVX, 8 lanes run as 2 SSE halves and were slower than 4
+#if defined(EW_SIMD_AVX)
+		typedef Float8 PacketFloat;
+#else
+		typedef Float4 PacketFloat;
+#endif
+		typedef Vec3xN<PacketFloat> PacketVec3;
+
+		//PacketFloat::WIDTH rays in structure-of-arrays form. Short packets repeat their last ray
+		struct RayPacket {
+			static const int WIDTH = PacketFloat::WIDTH;
+			PacketVec3 origin;
+			PacketVec3 direction;
+			PacketVec3 inverseDirection;
+			int count;
+
+			RayPacket(const Ray* rays, size_t numRays) {
+				count = numRays < (size_t)WIDTH ? (int)numRays : WIDTH;
+				ew::Vec3 origins[WIDTH], directions[WIDTH], inverses[WIDTH];
+				for (int i = 0; i < WIDTH; i++) {
+					const Ray& ray = rays[i < count ? i : count - 1];
+					origins[i] = ray.origin;
+					directions[i] = ray.direction;
+					inverses[i] = safeInverse(ray.direction);
+				}
+				origin = PacketVec3::Gather(origins);
+				direction = PacketVec3::Gather(directions);
+				inverseDirection = PacketVec3::Gather(inverses);
+			}
+
+			//Mask of active rays that hit child i of node before their tMax, and the nearest entry distance among them
+			inline int intersectChild(const BvhNode& node, int i, const PacketFloat& tMax, const PacketFloat& active, float* tNear)const {
+				const PacketVec3 boxMin(ew::Vec3(node.minX[i], node.minY[i], node.minZ[i]));
+				const PacketVec3 boxMax(ew::Vec3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+				const PacketVec3 t0 = (boxMin - origin) * inverseDirection;
+				const PacketVec3 t1 = (boxMax - origin) * inverseDirection;
+				const PacketVec3 near = Min(t0, t1);
+				const PacketVec3 far = Max(t0, t1);
+				const PacketFloat enter = Max(Max(near.x, near.y), Max(near.z, PacketFloat(0.0f)));
+				const PacketFloat exit = Min(Min(far.x, far.y), Min(far.z, tMax));
+				const PacketFloat hit = And(CmpLe(enter, exit), active);
+				*tNear = HorizontalMin(Select(hit, enter, PacketFloat(FLT_MAX)));
+				return MoveMask(hit);
+			}
+
+			//Mask of hits on the triangle with t in [0, tMax)
+			inline PacketFloat intersectTriangle(const ew::Vec3& v0, const ew::Vec3& edge1, const ew::Vec3& edge2, const PacketFloat& tMax, PacketFloat* t, PacketFloat* u, PacketFloat* v)const {
+				const PacketVec3 e1(edge1), e2(edge2);
+				const PacketVec3 p = Cross(direction, e2);
+				const PacketFloat inverseDet = PacketFloat(1.0f) / Dot(e1, p);
+				const PacketVec3 s = origin - PacketVec3(v0);
+				*u = Dot(s, p) * inverseDet;
+				const PacketVec3 q = Cross(s, e1);
+				*v = Dot(direction, q) * inverseDet;
+				*t = Dot(e2, q) * inverseDet;
+				//Ordered compares are false for NaN, so parallel rays never hit
+				const PacketFloat zero(0.0f), one(1.0f);
+				return And(And(And(CmpGe(*u, zero), CmpGe(*v, zero)), CmpLe(*u + *v, one)), And(CmpGe(*t, zero), CmpLt(*t, tMax)));
+			}
+
+			static inline float HorizontalMin(const PacketFloat& a) {
+				float lanes[WIDTH];
+				a.store(lanes);
+				float m = lanes[0];
+				for (int i = 1; i < WIDTH; i++) {
+					m = fminf(m, lanes[i]);
+				}
+				return m;
+			}
+		};
+	}
+
+	void Bvh::intersect(const Ray* rays, size_t count, RayHit* hits, float tMax) const
+	{
+		if (m_nodes.empty()) {
+			return;
+		}
+		const int WIDTH = RayPacket::WIDTH;
+		for (size_t first = 0; first < count; first += WIDTH) {
+			const RayPacket packet(rays + first, count - first);
+			PacketFloat closest(tMax);
+			const PacketFloat active = CmpEq(closest, closest);
+			uint32_t triangles[WIDTH];
+			float us[WIDTH], vs[WIDTH];
+			for (int i = 0; i < WIDTH; i++) {
+				triangles[i] = RayHit::NO_HIT;
+			}
+			StackEntry stack[STACK_SIZE];
+			int stackSize = 0;
+			stack[stackSize++] = { 0, 0.0f };
+			while (stackSize > 0) {
+				const StackEntry entry = stack[--stackSize];
+				//Skipped once every ray has a hit nearer than the node
+				if (MoveMask(CmpLt(PacketFloat(entry.tNear), closest)) == 0) {
+					continue;
+				}
+				const BvhNode& node = m_nodes[entry.node];
+				StackEntry inner[4];
+				int numInner = 0;
+				for (int i = 0; i < 4 && node.child[i] != BvhNode::EMPTY; i++) {
+					float tNear;
+					if (packet.intersectChild(node, i, closest, active, &tNear) == 0) {
+						continue;
+					}
+					if (node.count[i] == 0) {
+						int at = numInner++;
+						for (; at > 0 && inner[at - 1].tNear < tNear; at--) {
+							inner[at] = inner[at - 1];
+						}
+						inner[at] = { node.child[i], tNear };
+						continue;
+					}
+					for (uint32_t t = node.child[i]; t < node.child[i] + node.count[i]; t++) {
+						const Triangle& triangle = m_triangles[t];
+						PacketFloat tHit, u, v;
+						const PacketFloat hit = packet.intersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, closest, &tHit, &u, &v);
+						const int mask = MoveMask(hit);
+						if (mask == 0) {
+							continue;
+						}
+						closest = Select(hit, tHit, closest);
+						float laneU[WIDTH], laneV[WIDTH];
+						u.store(laneU);
+						v.store(laneV);
+						for (int lane = 0; lane < WIDTH; lane++) {
+							if (mask & (1 << lane)) {
+								triangles[lane] = t;
+								us[lane] = laneU[lane];
+								vs[lane] = laneV[lane];
+							}
+						}
+					}
+				}
+				for (int i = 0; i < numInner; i++) {
+					stack[stackSize++] = inner[i];
+				}
+			}
+			float ts[WIDTH];
+			closest.store(ts);
+			for (int lane = 0; lane < packet.count; lane++) {
+				if (triangles[lane] == RayHit::NO_HIT) {
+					continue;
+				}
+				RayHit& hit = hits[first + lane];
+				hit.t = ts[lane];
+				hit.triangle = m_triangleIds[triangles[lane]];
+				hit.u = us[lane];
+				hit.v = vs[lane];
+			}
+		}
+	}
+
+	void Bvh::occluded(const Ray* rays, size_t count, unsigned char* occluded, float tMax) const
+	{
+		const int WIDTH = RayPacket::WIDTH;
+		for (size_t first = 0; first < count; first += WIDTH) {
+			const int numRays = count - first < (size_t)WIDTH ? (int)(count - first) : WIDTH;
+			int blocked = 0;
+			if (!m_nodes.empty()) {
+				const RayPacket packet(rays + first, count - first);
+				const PacketFloat limit(tMax);
+				//Lanes of rays that have not hit anything yet
+				PacketFloat active = CmpEq(limit, limit);
+				const int allLanes = MoveMask(active);
+				uint32_t stack[STACK_SIZE];
+				int stackSize = 0;
+				stack[stackSize++] = 0;
+				while (stackSize > 0 && blocked != allLanes) {
+					const BvhNode& node = m_nodes[stack[--stackSize]];
+					for (int i = 0; i < 4 && node.child[i] != BvhNode::EMPTY && blocked != allLanes; i++) {
+						float tNear;
+						if (packet.intersectChild(node, i, limit, active, &tNear) == 0) {
+							continue;
+						}
+						if (node.count[i] == 0) {
+							stack[stackSize++] = node.child[i];
+							continue;
+						}
+						for (uint32_t t = node.child[i]; t < node.child[i] + node.count[i]; t++) {
+							const Triangle& triangle = m_triangles[t];
+							PacketFloat tHit, u, v;
+							const PacketFloat hit = packet.intersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, limit, &tHit, &u, &v);
+							blocked |= MoveMask(hit);
+							active = Select(hit, PacketFloat(0.0f), active);
+						}
+					}
+				}
+			}
+			for (int lane = 0; lane < numRays; lane++) {
+				occluded[first + lane] = (blocked >> lane) & 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <float.h>
+#include <vector>
+#include "mesh.h"
+
+namespace ew {
+	struct Ray {
+		ew::Vec3 origin;
+		ew::Vec3 direction; //Need not be normalized. Hit distances are in multiples of it
+	};
+
+	struct RayHit {
+		static const uint32_t NO_HIT = 0xFFFFFFFFu;
+		float t = FLT_MAX;
+		uint32_t triangle = NO_HIT; //Index of the triangle in MeshData::indices / 3
+		//Barycentric weights of the triangle's second and third vertex
+		float u = 0.0f;
+		float v = 0.0f;
+
+		inline bool hit()const { return triangle != NO_HIT; }
+	};
+
+	//Ray through a point on screen, e.g. the mouse, in world space. ndc is in [-1, 1] with y up.
+	//Starts on the near plane with a normalized direction, so t is the distance from the near plane
+	Ray ScreenPointToRay(const ew::Mat4& inverseViewProjection, float ndcX, float ndcY);
+	//Ray in the space m maps to, e.g. into model space with the inverse model matrix.
+	//The direction is not renormalized, so a hit has the same t in both spaces
+	Ray TransformRay(const Ray& ray, const ew::Mat4& m);
+
+	//Node of a 4 wide bvh, with the bounds of its children in structure-of-arrays form so a ray tests all 4 at once.
+	//A child is a leaf if count > 0, holding triangles [child, child + count), an inner node if count == 0,
+	//or empty if child is EMPTY. Nodes are stored parent first, so children always come after their parent
+	struct BvhNode {
+		static const uint32_t EMPTY = 0xFFFFFFFFu;
+		float minX[4], minY[4], minZ[4];
+		float maxX[4], maxY[4], maxZ[4];
+		uint32_t child[4];
+		uint32_t count[4];
+	};
+
+	//Bounding volume hierarchy over the triangles of a MeshData for CPU ray queries like picking and occlusion probes.
+	//Built with binned SAH splits, parallel across threads for large meshes. Triangles are copied in leaf order,
+	//so queries never touch the MeshData
+	class Bvh {
+	public:
+		static const size_t MAX_LEAF_TRIANGLES = 8;
+
+		void build(const MeshData& meshData);
+		//Updates bounds after vertices moved, keeping the tree. Much faster than build, but queries slow down
+		//as the tree drifts from the new shape. meshData must have the same indices as when it was built
+		void refit(const MeshData& meshData);
+		void clear();
+
+		//Closest hit with t in [0, tMax). Returns false and leaves hit unchanged if there is none
+		bool intersect(const Ray& ray, RayHit* hit, float tMax = FLT_MAX)const;
+		//True if anything is hit with t in [0, tMax). Stops at the first hit, so it is cheaper than intersect
+		bool occluded(const Ray& ray, float tMax = FLT_MAX)const;
+		//Traces rays 4 at a time, or 8 with AVX. Neighboring rays should point the same way, e.g. rays through
+		//neighboring pixels; scattered rays are slower than tracing one at a time. Packets only beat single rays
+		//with AVX, and then mostly for occluded. hits[i] is left unchanged if ray i misses
+		void intersect(const Ray* rays, size_t count, RayHit* hits, float tMax = FLT_MAX)const;
+		//occluded[i] is set to 1 if ray i hits anything with t in [0, tMax), 0 otherwise
+		void occluded(const Ray* rays, size_t count, unsigned char* occluded, float tMax = FLT_MAX)const;
+
+		AABB getBounds()const;
+		inline size_t getNumNodes()const { return m_nodes.size(); }
+		inline size_t getNumTriangles()const { return m_triangles.size(); }
+		inline const std::vector<BvhNode>& getNodes()const { return m_nodes; }
+
+	private:
+		//Precomputed for Moller-Trumbore
+		struct Triangle {
+			ew::Vec3 v0;
+			ew::Vec3 edge1;
+			ew::Vec3 edge2;
+		};
+
+		void updateTriangles(const MeshData& meshData);
+
+		std::vector<BvhNode> m_nodes;
+		std::vector<Triangle> m_triangles; //In leaf order
+		std::vector<uint32_t> m_triangleIds; //Index in MeshData of each triangle in m_triangles
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "ewMath/transformations.h"
 #include "ewMath/ewMath.h"
+#include "ewMath/frustum.h"
 namespace ew {
 
 	struct Camera {
@@ -14,17 +15,91 @@ namespace ew {
 		float orthoHeight = 6.0f;
 		float aspectRatio = 1.77f;
 
-		inline ew::Mat4 ViewMatrix()const {
-			return ew::LookAt(position, target, ew::Vec3(0, 1, 0));
+		//Derived matrices are cached and only rebuilt when the fields above change,
+		//so these can be called any number of times per frame
+		inline const ew::Mat4& ViewMatrix()const {
+			updateCache();
+			return m_view;
 		}
-		inline ew::Mat4 ProjectionMatrix()const {
+		inline const ew::Mat4& ProjectionMatrix()const {
+			updateCache();
+			return m_projection;
+		}
+		//ProjectionMatrix() * ViewMatrix()
+		inline const ew::Mat4& ViewProjectionMatrix()const {
+			updateCache();
+			return m_viewProjection;
+		}
+		inline const ew::Mat4& InverseViewMatrix()const {
+			updateCache();
+			return m_inverseView;
+		}
+		inline const ew::Mat4& InverseProjectionMatrix()const {
+			updateCache();
+			return m_inverseProjection;
+		}
+		inline const ew::Mat4& InverseViewProjectionMatrix()const {
+			updateCache();
+			return m_inverseViewProjection;
+		}
+		//World space frustum planes
+		inline const ew::Frustum& GetFrustum()const {
+			updateCache();
+			return m_frustum;
+		}
+
+	private:
+		//Values the cached matrices were built from
+		struct ViewKey {
+			ew::Vec3 position;
+			ew::Vec3 target;
+		};
+		struct ProjectionKey {
+			float fov, nearPlane, farPlane, orthoHeight, aspectRatio;
+			bool orthographic;
+		};
 
-			if (orthographic) {
-				return ew::Orthographic(orthoHeight, aspectRatio, nearPlane, farPlane);
+		mutable bool m_cacheValid = false;
+		mutable ViewKey m_viewKey;
+		mutable ProjectionKey m_projectionKey;
+		mutable ew::Mat4 m_view;
+		mutable ew::Mat4 m_projection;
+		mutable ew::Mat4 m_viewProjection;
+		mutable ew::Mat4 m_inverseView;
+		mutable ew::Mat4 m_inverseProjection;
+		mutable ew::Mat4 m_inverseViewProjection;
+		mutable ew::Frustum m_frustum;
+
+		inline void updateCache()const {
+			const bool viewDirty = !m_cacheValid
+				|| position.x != m_viewKey.position.x || position.y != m_viewKey.position.y || position.z != m_viewKey.position.z
+				|| target.x != m_viewKey.target.x || target.y != m_viewKey.target.y || target.z != m_viewKey.target.z;
+			const bool projectionDirty = !m_cacheValid
+				|| fov != m_projectionKey.fov || nearPlane != m_projectionKey.nearPlane || farPlane != m_projectionKey.farPlane
+				|| orthoHeight != m_projectionKey.orthoHeight || aspectRatio != m_projectionKey.aspectRatio
+				|| orthographic != m_projectionKey.orthographic;
+			if (!viewDirty && !projectionDirty) {
+				return;
+			}
+			if (viewDirty) {
+				m_viewKey = { position, target };
+				m_view = ew::LookAt(position, target, ew::Vec3(0, 1, 0));
+				m_inverseView = ew::AffineInverse(m_view);
 			}
-			else {
-				return ew::Perspective(ew::Radians(fov), aspectRatio, nearPlane, farPlane);
+			if (projectionDirty) {
+				m_projectionKey = { fov, nearPlane, farPlane, orthoHeight, aspectRatio, orthographic };
+				if (orthographic) {
+					m_projection = ew::Orthographic(orthoHeight, aspectRatio, nearPlane, farPlane);
+				}
+				else {
+					m_projection = ew::Perspective(ew::Radians(fov), aspectRatio, nearPlane, farPlane);
+				}
+				m_inverseProjection = ew::Inverse(m_projection);
 			}
+			m_viewProjection = m_projection * m_view;
+			m_inverseViewProjection = m_inverseView * m_inverseProjection;
+			m_frustum = ew::ExtractFrustum(m_viewProjection);
+			m_cacheValid = true;
 		}
 	};
 
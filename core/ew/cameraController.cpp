@@ -1,4 +1,5 @@
 #include "cameraController.h"
+#include "ewMath/fastTrig.h"
 namespace ew {
 	void CameraController::Move(GLFWwindow* window, ew::Camera* camera, float deltaTime) {
 		//Only allow movement if right mouse is held
@@ -39,11 +40,15 @@ namespace ew {
 			float yawRad = ew::Radians(yaw);
 			float pitchRad = ew::Radians(pitch);
 
+			float sinYaw, cosYaw, sinPitch, cosPitch;
+			ew::FastSinCos(yawRad, &sinYaw, &cosYaw);
+			ew::FastSinCos(pitchRad, &sinPitch, &cosPitch);
+
 			//Construct forward, right, and up vectors
 			ew::Vec3 forward;
-			forward.x = cosf(pitchRad) * sinf(yawRad);
-			forward.y = sinf(pitchRad);
-			forward.z = cosf(pitchRad) * -cosf(yawRad);
+			forward.x = cosPitch * sinYaw;
+			forward.y = sinPitch;
+			forward.z = cosPitch * -cosYaw;
 			forward = ew::Normalize(forward);
 
 			ew::Vec3 right = ew::Normalize(ew::Cross(forward, ew::Vec3(0, 1, 0)));
@@ -0,0 +1,79 @@
+#include "culling.h"
+#include "ewMath/packet.h"
+
+namespace ew {
+	//Tests Float4::WIDTH objects in structure-of-arrays form against every plane.
+	//Objects are spheres when extents is null, otherwise boxes with those half extents.
+	//Returns a bit mask of visible objects.
+	static int cullPacket(const Frustum& frustum, const ew::Vec3x4& center, const ew::Float4& radius, const ew::Vec3x4* extents) {
+		ew::Float4 inside = ew::CmpEq(radius, radius);
+		for (int i = 0; i < Frustum::PLANE_COUNT; i++) {
+			const ew::Vec4& p = frustum.planes[i];
+			const ew::Vec3x4 normal(p.toVec3());
+			const ew::Float4 dist = ew::Dot(normal, center) + ew::Float4(p.w);
+			ew::Float4 r = radius;
+			if (extents) {
+				//Projected radius of the box onto the plane normal
+				r = ew::Dot(ew::Vec3x4(ew::Vec3(fabsf(p.x), fabsf(p.y), fabsf(p.z))), *extents);
+			}
+			//Visible while dist >= -r
+			inside = ew::And(inside, ew::CmpGe(dist + r, ew::Float4(0.0f)));
+		}
+		return ew::MoveMask(inside);
+	}
+
+	static size_t writeMask(int mask, unsigned char* visible) {
+		size_t numVisible = 0;
+		for (int lane = 0; lane < Float4::WIDTH; lane++) {
+			visible[lane] = (mask >> lane) & 1;
+			numVisible += visible[lane];
+		}
+		return numVisible;
+	}
+
+	size_t CullSpheres(const Frustum& frustum, const BoundingSphere* spheres, size_t count, unsigned char* visible, CullStats* stats) {
+		const size_t WIDTH = Float4::WIDTH;
+		size_t numVisible = 0;
+		size_t i = 0;
+		for (; i + WIDTH <= count; i += WIDTH) {
+			float radii[WIDTH];
+			for (size_t lane = 0; lane < WIDTH; lane++) {
+				radii[lane] = spheres[i + lane].radius;
+			}
+			const ew::Vec3x4 center = ew::Vec3x4::Gather(&spheres[i].center, sizeof(BoundingSphere));
+			numVisible += writeMask(cullPacket(frustum, center, ew::Float4::Load(radii), nullptr), visible + i);
+		}
+		for (; i < count; i++) {
+			visible[i] = ew::IsVisible(frustum, spheres[i]) ? 1 : 0;
+			numVisible += visible[i];
+		}
+		if (stats) {
+			stats->tested += count;
+			stats->visible += numVisible;
+		}
+		return numVisible;
+	}
+
+	size_t CullAABBs(const Frustum& frustum, const AABB* boxes, size_t count, unsigned char* visible, CullStats* stats) {
+		const size_t WIDTH = Float4::WIDTH;
+		size_t numVisible = 0;
+		size_t i = 0;
+		for (; i + WIDTH <= count; i += WIDTH) {
+			const ew::Vec3x4 boxMin = ew::Vec3x4::Gather(&boxes[i].min, sizeof(AABB));
+			const ew::Vec3x4 boxMax = ew::Vec3x4::Gather(&boxes[i].max, sizeof(AABB));
+			const ew::Float4 half(0.5f);
+			const ew::Vec3x4 center = (boxMin + boxMax) * half;
+			const ew::Vec3x4 extents = (boxMax - boxMin) * half;
+			numVisible += writeMask(cullPacket(frustum, center, ew::Float4(0.0f), &extents), visible + i);
+		}
+		for (; i < count; i++) {
+			visible[i] = ew::IsVisible(frustum, boxes[i]) ? 1 : 0;
+			numVisible += visible[i];
+		}
+		if (stats) {
+			stats->tested += count;
+			stats->visible += numVisible;
+		}
+		return numVisible;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+#include "ewMath/frustum.h"
+
+namespace ew {
+	//Running totals across cull calls, e.g. for one frame
+	struct CullStats {
+		size_t tested = 0;
+		size_t visible = 0;
+
+		inline size_t culled()const { return tested - visible; }
+		inline void reset() { tested = 0; visible = 0; }
+	};
+
+	//Tests count world space bounds against the frustum, several at a time.
+	//visible[i] is set to 1 if bounds i may be inside the frustum, 0 otherwise.
+	//Returns the number of visible bounds and adds to stats if it is not null.
+	size_t CullSpheres(const Frustum& frustum, const BoundingSphere* spheres, size_t count, unsigned char* visible, CullStats* stats = nullptr);
+	size_t CullAABBs(const Frustum& frustum, const AABB* boxes, size_t count, unsigned char* visible, CullStats* stats = nullptr);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <math.h>
+#include "vec3.h"
+#include "vec4.h"
+#include "mat4.h"
+
+namespace ew {
+	//Axis aligned bounding box
+	struct AABB {
+		ew::Vec3 min = ew::Vec3(0.0f);
+		ew::Vec3 max = ew::Vec3(0.0f);
+
+		inline ew::Vec3 center()const { return (min + max) * 0.5f; }
+		inline ew::Vec3 extents()const { return (max - min) * 0.5f; }
+	};
+
+	struct BoundingSphere {
+		ew::Vec3 center = ew::Vec3(0.0f);
+		float radius = 0.0f;
+	};
+
+	//Smallest AABB containing box after it is transformed by m (Arvo's method)
+	inline AABB TransformAABB(const AABB& box, const ew::Mat4& m) {
+		const ew::Vec3 c = box.center();
+		const ew::Vec3 e = box.extents();
+		const ew::Vec3 worldCenter = (m * ew::Vec4(c, 1.0f)).toVec3();
+		const ew::Vec3 worldExtents(
+			fabsf(m[0][0]) * e.x + fabsf(m[1][0]) * e.y + fabsf(m[2][0]) * e.z,
+			fabsf(m[0][1]) * e.x + fabsf(m[1][1]) * e.y + fabsf(m[2][1]) * e.z,
+			fabsf(m[0][2]) * e.x + fabsf(m[1][2]) * e.y + fabsf(m[2][2]) * e.z
+		);
+		AABB out;
+		out.min = worldCenter - worldExtents;
+		out.max = worldCenter + worldExtents;
+		return out;
+	}
+
+	//Sphere containing sphere after it is transformed by m. Radius is scaled by the largest axis scale
+	inline BoundingSphere TransformSphere(const BoundingSphere& sphere, const ew::Mat4& m) {
+		const float sx = ew::Dot(m[0].toVec3(), m[0].toVec3());
+		const float sy = ew::Dot(m[1].toVec3(), m[1].toVec3());
+		const float sz = ew::Dot(m[2].toVec3(), m[2].toVec3());
+		const float maxScaleSq = fmaxf(sx, fmaxf(sy, sz));
+		BoundingSphere out;
+		out.center = (m * ew::Vec4(sphere.center, 1.0f)).toVec3();
+		out.radius = sphere.radius * sqrtf(maxScaleSq);
+		return out;
+	}
+}
@@ -9,6 +9,9 @@
 #include "vec2.h"
 #include "vec3.h"
 #include "mat4.h"
+#include "mat3.h"
+#include "quat.h"
+#include "random.h"
 
 namespace ew {
 	constexpr float PI = 3.14159265359f;
@@ -21,9 +24,9 @@ namespace ew {
 	inline float Degrees(float radians) {
 		return radians * RAD2DEG;
 	}
+	//Uniform float in [min, max) from the calling thread's generator. See ThreadRng
 	inline float RandomRange(float min, float max) {
-		float t = (float)rand() / RAND_MAX;
-		return min + (max - min) * t;
+		return ThreadRng().range(min, max);
 	}
 	inline float Clamp(float x, float min, float max) {
 		return std::fminf(std::fmaxf(x, min), max);
@@ -0,0 +1,99 @@
+#pragma once
+#include <math.h>
+#include "packet.h"
+
+//Fast sine and cosine for single floats and Float4/Float8 packets.
+//The argument is reduced to [-PI/4, PI/4] with a three part Cody-Waite split of PI/2, then evaluated with
+//minimax polynomials (Cephes sinf/cosf coefficients).
+//Max absolute error against double precision sin/cos:
+//	|x| <= 10000:  1e-7 (about 1 ulp near 1)
+//	|x| <= 100000: 1e-6
+//Larger arguments lose precision in the reduction and should use sinf/cosf.
+//Scalar and packet versions perform the same operations, so their results match lane for lane unless the compiler
+//contracts multiplies and adds into FMA, which GCC and Clang may do whenever FMA is enabled (e.g. -mfma).
+//Contracted versions can differ by about 1 ulp (up to 1.19e-7). Build with -ffp-contract=off to keep them identical.
+//benchmarks/trigBenchmark.cpp compares speed and error against sinf/cosf
+namespace ew {
+	namespace fast_trig_detail {
+		constexpr float TWO_OVER_PI = 0.63661977236758134f;
+		//PI/2 = DP1 + DP2 + DP3, where q * DP1 and q * DP2 are exact for the supported range
+		constexpr float DP1 = 1.5703125f;
+		constexpr float DP2 = 4.837512969970703125e-4f;
+		constexpr float DP3 = 7.54978995489188216e-8f;
+		constexpr float S1 = -1.6666654611e-1f;
+		constexpr float S2 = 8.3321608736e-3f;
+		constexpr float S3 = -1.9515295891e-4f;
+		constexpr float C1 = 4.166664568298827e-2f;
+		constexpr float C2 = -1.388731625493765e-3f;
+		constexpr float C3 = 2.443315711809948e-5f;
+	}
+
+	//Writes sin(x) and cos(x)
+	inline void FastSinCos(float x, float* sinOut, float* cosOut) {
+		using namespace fast_trig_detail;
+		//Rounded like the packet Round, since nearbyintf is a library call below SSE4.1
+		const float q = (x * TWO_OVER_PI + 12582912.0f) - 12582912.0f;
+		const float r = ((x - q * DP1) - q * DP2) - q * DP3;
+		const float r2 = r * r;
+		const float sinR = r + r * r2 * (S1 + r2 * (S2 + r2 * S3));
+		const float cosR = 1.0f - 0.5f * r2 + r2 * r2 * (C1 + r2 * (C2 + r2 * C3));
+		//Quadrant of x. Two's complement keeps & 3 correct for negative q
+		const int quadrant = (int)q & 3;
+		const float s = (quadrant & 1) ? cosR : sinR;
+		const float c = (quadrant & 1) ? sinR : cosR;
+		*sinOut = quadrant >= 2 ? -s : s;
+		*cosOut = (quadrant == 1 || quadrant == 2) ? -c : c;
+	}
+	inline float FastSin(float x) {
+		float s, c;
+		FastSinCos(x, &s, &c);
+		return s;
+	}
+	inline float FastCos(float x) {
+		float s, c;
+		FastSinCos(x, &s, &c);
+		return c;
+	}
+	//Relative error grows near odd multiples of PI/2, where tan is unbounded
+	inline float FastTan(float x) {
+		float s, c;
+		FastSinCos(x, &s, &c);
+		return s / c;
+	}
+
+	//Packet sine and cosine. F is Float4 or Float8
+	template <typename F>
+	inline void FastSinCos(const F& x, F* sinOut, F* cosOut) {
+		using namespace fast_trig_detail;
+		const F q = Round(x * F(TWO_OVER_PI));
+		const F r = ((x - q * F(DP1)) - q * F(DP2)) - q * F(DP3);
+		const F r2 = r * r;
+		const F sinR = r + r * r2 * (F(S1) + r2 * (F(S2) + r2 * F(S3)));
+		const F cosR = F(1.0f) - F(0.5f) * r2 + r2 * r2 * (F(C1) + r2 * (F(C2) + r2 * F(C3)));
+		//Quadrant of x, 0 to 3
+		const F quadrant = q - F(4.0f) * Floor(q * F(0.25f));
+		const F odd = Or(CmpEq(quadrant, F(1.0f)), CmpEq(quadrant, F(3.0f)));
+		const F s = Select(odd, cosR, sinR);
+		const F c = Select(odd, sinR, cosR);
+		*sinOut = Select(CmpGe(quadrant, F(2.0f)), -s, s);
+		*cosOut = Select(Or(CmpEq(quadrant, F(1.0f)), CmpEq(quadrant, F(2.0f))), -c, c);
+	}
+	template <typename F>
+	inline F FastSin(const F& x) {
+		F s, c;
+		FastSinCos(x, &s, &c);
+		return s;
+	}
+	template <typename F>
+	inline F FastCos(const F& x) {
+		F s, c;
+		FastSinCos(x, &s, &c);
+		return c;
+	}
+	template <typename F>
+	inline F FastTan(const F& x) {
+		F s, c;
+		FastSinCos(x, &s, &c);
+		return s / c;
+	}
+}
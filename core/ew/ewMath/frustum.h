@@ -0,0 +1,76 @@
+#pragma once
+#include "vec3.h"
+#include "vec4.h"
+#include "mat4.h"
+#include "bounds.h"
+
+namespace ew {
+	//Six planes bounding a view volume. Each plane is (normal, distance) with the normal pointing inward,
+	//so a point p is inside a plane when Dot(normal, p) + distance >= 0
+	struct Frustum {
+		//Suffixed because windows.h defines NEAR and FAR
+		enum Plane {
+			LEFT_PLANE = 0,
+			RIGHT_PLANE,
+			BOTTOM_PLANE,
+			TOP_PLANE,
+			NEAR_PLANE,
+			FAR_PLANE,
+			PLANE_COUNT
+		};
+		ew::Vec4 planes[PLANE_COUNT];
+	};
+
+	inline ew::Vec4 NormalizePlane(const ew::Vec4& p) {
+		const float mag = ew::Magnitude(p.toVec3());
+		if (mag == 0)
+			return p;
+		const float invMag = 1.0f / mag;
+		return ew::Vec4(p.x * invMag, p.y * invMag, p.z * invMag, p.w * invMag);
+	}
+
+	//Extracts world space frustum planes from a view projection matrix (Gribb/Hartmann).
+	//Assumes OpenGL clip space, where -w <= z <= w
+	inline Frustum ExtractFrustum(const ew::Mat4& viewProjection) {
+		const ew::Mat4& m = viewProjection;
+		//Rows of the matrix
+		const ew::Vec4 r0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		const ew::Vec4 r1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		const ew::Vec4 r2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		const ew::Vec4 r3(m[0][3], m[1][3], m[2][3], m[3][3]);
+		Frustum frustum;
+		frustum.planes[Frustum::LEFT_PLANE] = NormalizePlane(ew::Vec4(r3.x + r0.x, r3.y + r0.y, r3.z + r0.z, r3.w + r0.w));
+		frustum.planes[Frustum::RIGHT_PLANE] = NormalizePlane(ew::Vec4(r3.x - r0.x, r3.y - r0.y, r3.z - r0.z, r3.w - r0.w));
+		frustum.planes[Frustum::BOTTOM_PLANE] = NormalizePlane(ew::Vec4(r3.x + r1.x, r3.y + r1.y, r3.z + r1.z, r3.w + r1.w));
+		frustum.planes[Frustum::TOP_PLANE] = NormalizePlane(ew::Vec4(r3.x - r1.x, r3.y - r1.y, r3.z - r1.z, r3.w - r1.w));
+		frustum.planes[Frustum::NEAR_PLANE] = NormalizePlane(ew::Vec4(r3.x + r2.x, r3.y + r2.y, r3.z + r2.z, r3.w + r2.w));
+		frustum.planes[Frustum::FAR_PLANE] = NormalizePlane(ew::Vec4(r3.x - r2.x, r3.y - r2.y, r3.z - r2.z, r3.w - r2.w));
+		return frustum;
+	}
+
+	//True if any part of the sphere may be inside the frustum
+	inline bool IsVisible(const Frustum& frustum, const BoundingSphere& sphere) {
+		for (int i = 0; i < Frustum::PLANE_COUNT; i++) {
+			const ew::Vec4& p = frustum.planes[i];
+			if (ew::Dot(p.toVec3(), sphere.center) + p.w < -sphere.radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//True if any part of the box may be inside the frustum
+	inline bool IsVisible(const Frustum& frustum, const AABB& box) {
+		const ew::Vec3 c = box.center();
+		const ew::Vec3 e = box.extents();
+		for (int i = 0; i < Frustum::PLANE_COUNT; i++) {
+			const ew::Vec4& p = frustum.planes[i];
+			//Projected radius of the box onto the plane normal
+			const float r = fabsf(p.x) * e.x + fabsf(p.y) * e.y + fabsf(p.z) * e.z;
+			if (ew::Dot(p.toVec3(), c) + p.w < -r) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
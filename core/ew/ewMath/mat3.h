@@ -0,0 +1,72 @@
+#pragma once
+#include "vec3.h"
+#include "mat4.h"
+
+namespace ew {
+	//Column-major 3x3 matrix, laid out like Mat4 so it can be uploaded with glUniformMatrix3fv
+	struct Mat3 {
+	private:
+		float n[3][3];
+	public:
+		Mat3() = default;
+		constexpr Mat3(float n00, float n10, float n20,
+			 float n01, float n11, float n21,
+			 float n02, float n12, float n22)
+			:n{ { n00, n01, n02 },
+				{ n10, n11, n12 },
+				{ n20, n21, n22 } }
+		{};
+		//Construct from columns
+		constexpr Mat3(const Vec3& a, const Vec3& b, const Vec3& c)
+			:n{ { a.x, a.y, a.z },
+				{ b.x, b.y, b.z },
+				{ c.x, c.y, c.z } }
+		{}
+		//Upper-left 3x3 of m
+		constexpr explicit Mat3(const Mat4& m)
+			:Mat3(m.get(0, 0), m.get(1, 0), m.get(2, 0),
+				m.get(0, 1), m.get(1, 1), m.get(2, 1),
+				m.get(0, 2), m.get(1, 2), m.get(2, 2)) {}
+		//Element at column col, row row. Unlike operator[], usable in constant expressions
+		constexpr float get(int col, int row) const {
+			return n[col][row];
+		}
+
+		inline Vec3& operator[](int i) {
+			return (*reinterpret_cast<Vec3*>(n[i]));
+		}
+		inline const Vec3& operator[](int i) const {
+			return (*reinterpret_cast<const Vec3*>(n[i]));
+		}
+		inline friend Vec3 operator * (const Mat3& m, const Vec3& v) {
+			return m[0] * v.x + m[1] * v.y + m[2] * v.z;
+		}
+	};
+
+	inline constexpr Mat3 Transpose(const Mat3& m) {
+		//Rows of the result are the columns of m
+		return Mat3(
+			m.get(0, 0), m.get(0, 1), m.get(0, 2),
+			m.get(1, 0), m.get(1, 1), m.get(1, 2),
+			m.get(2, 0), m.get(2, 1), m.get(2, 2)
+		);
+	}
+
+	//Inverse-transpose of the upper-left 3x3 of a model matrix.
+	//Transforms normals correctly under non-uniform scale.
+	inline Mat3 NormalMatrix(const Mat4& model) {
+		const Vec3 c0 = model[0].toVec3();
+		const Vec3 c1 = model[1].toVec3();
+		const Vec3 c2 = model[2].toVec3();
+		//Columns of the inverse-transpose are the cross products of the other two columns
+		const Vec3 x = Cross(c1, c2);
+		const Vec3 y = Cross(c2, c0);
+		const Vec3 z = Cross(c0, c1);
+		const float det = Dot(c0, x);
+		if (det == 0) {
+			return Mat3(x, y, z);
+		}
+		const float invDet = 1.0f / det;
+		return Mat3(x * invDet, y * invDet, z * invDet);
+	}
+}
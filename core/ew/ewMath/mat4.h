@@ -4,36 +4,41 @@
 
 #pragma once
 #include "vec4.h"
+#include "simd.h"
 #include <cstddef>
 
 namespace ew {
+	//GCC already auto-vectorizes the scalar products at -O2, so there the SSE kernels roughly break even.
+	//The intrinsics only pay off where the compiler doesn't vectorize. benchmarks/mat4Benchmark.cpp compares the backends
 	struct Mat4 {
 	private:
 		float n[4][4];
 	public:
 		Mat4() = default;
-		Mat4(float n00)
-		{
-			n[0][0] = n00; n[1][0] = n00; n[2][0] = n00; n[3][0] = n00;
-			n[0][1] = n00; n[1][1] = n00; n[2][1] = n00; n[3][1] = n00;
-			n[0][2] = n00; n[1][2] = n00; n[2][2] = n00; n[3][2] = n00;
-			n[0][3] = n00; n[1][3] = n00; n[2][3] = n00; n[3][3] = n00;
-		};
-		Mat4(float n00, float n10, float n20, float n30,
+		constexpr Mat4(float n00)
+			:n{ { n00, n00, n00, n00 },
+				{ n00, n00, n00, n00 },
+				{ n00, n00, n00, n00 },
+				{ n00, n00, n00, n00 } }
+		{};
+		constexpr Mat4(float n00, float n10, float n20, float n30,
 			 float n01, float n11, float n21, float n31,
 			 float n02, float n12, float n22, float n32,
 			 float n03, float n13, float n23, float n33)
-		{
-			n[0][0] = n00; n[1][0] = n10; n[2][0] = n20; n[3][0] = n30;
-			n[0][1] = n01; n[1][1] = n11; n[2][1] = n21; n[3][1] = n31;
-			n[0][2] = n02; n[1][2] = n12; n[2][2] = n22; n[3][2] = n32;
-			n[0][3] = n03; n[1][3] = n13; n[2][3] = n23; n[3][3] = n33;
-		};
-		Mat4(const Vec4& a, const Vec4& b, const Vec4& c, const Vec4& d) {
-			n[0][0] = a.x; n[0][1] = a.y; n[0][2] = a.z; n[0][3] = a.w;
-			n[1][0] = b.x; n[1][1] = b.y; n[1][2] = b.z; n[1][3] = b.w;
-			n[2][0] = c.x; n[2][1] = c.y; n[2][2] = c.z; n[2][3] = c.w;
-			n[3][0] = d.x; n[3][1] = d.y; n[3][2] = d.z; n[3][3] = d.w;
+			:n{ { n00, n01, n02, n03 },
+				{ n10, n11, n12, n13 },
+				{ n20, n21, n22, n23 },
+				{ n30, n31, n32, n33 } }
+		{};
+		constexpr Mat4(const Vec4& a, const Vec4& b, const Vec4& c, const Vec4& d)
+			:n{ { a.x, a.y, a.z, a.w },
+				{ b.x, b.y, b.z, b.w },
+				{ c.x, c.y, c.z, c.w },
+				{ d.x, d.y, d.z, d.w } }
+		{}
+		//Element at column col, row row. Unlike operator[], usable in constant expressions
+		constexpr float get(int col, int row) const {
+			return n[col][row];
 		}
 		inline Vec4& operator[](int i) {
 			return (*reinterpret_cast<Vec4*>(n[i]));
@@ -42,39 +47,106 @@ namespace ew {
 			return (*reinterpret_cast<const Vec4*>(n[i]));
 		}
 		inline friend Vec4 operator * (const Mat4& m, const Vec4& v) {
+#if defined(EW_SIMD_SSE)
+			//Sum of columns scaled by v, accumulated in the same order as the scalar path
+			const __m128 p = _mm_loadu_ps(&v.x);
+			__m128 r = _mm_mul_ps(_mm_loadu_ps(m.n[0]), _mm_shuffle_ps(p, p, 0x00));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m.n[1]), _mm_shuffle_ps(p, p, 0x55)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m.n[2]), _mm_shuffle_ps(p, p, 0xAA)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m.n[3]), _mm_shuffle_ps(p, p, 0xFF)));
+			Vec4 out;
+			_mm_storeu_ps(&out.x, r);
+			return out;
+#elif defined(EW_SIMD_NEON)
+			float32x4_t r = vmulq_n_f32(vld1q_f32(m.n[0]), v.x);
+			r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(m.n[1]), v.y));
+			r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(m.n[2]), v.z));
+			r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(m.n[3]), v.w));
+			Vec4 out;
+			vst1q_f32(&out.x, r);
+			return out;
+#else
 			return Vec4(
 				m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z + m[3][0] * v.w,
 				m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z + m[3][1] * v.w,
 				m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z + m[3][2] * v.w,
 				m[0][3] * v.x + m[1][3] * v.y + m[2][3] * v.z + m[3][3] * v.w
 			);
+#endif
 		}
 		inline friend Mat4 operator * (const Mat4& l, const Mat4& r) {
 			Mat4 m;
+#if defined(EW_SIMD_AVX)
+			//Two result columns per iteration. Each 128-bit half is l * r[j], summed in scalar order
+			const __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l.n[0]));
+			const __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l.n[1]));
+			const __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l.n[2]));
+			const __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l.n[3]));
+			for (int j = 0; j < 4; j += 2) {
+				const __m256 rj = _mm256_loadu_ps(r.n[j]);
+				__m256 col = _mm256_mul_ps(c0, _mm256_shuffle_ps(rj, rj, 0x00));
+				col = _mm256_add_ps(col, _mm256_mul_ps(c1, _mm256_shuffle_ps(rj, rj, 0x55)));
+				col = _mm256_add_ps(col, _mm256_mul_ps(c2, _mm256_shuffle_ps(rj, rj, 0xAA)));
+				col = _mm256_add_ps(col, _mm256_mul_ps(c3, _mm256_shuffle_ps(rj, rj, 0xFF)));
+				_mm256_storeu_ps(m.n[j], col);
+			}
+#elif defined(EW_SIMD_SSE)
+			//Result column j = l * r[j], summed in the same order as the scalar path
+			const __m128 c0 = _mm_loadu_ps(l.n[0]);
+			const __m128 c1 = _mm_loadu_ps(l.n[1]);
+			const __m128 c2 = _mm_loadu_ps(l.n[2]);
+			const __m128 c3 = _mm_loadu_ps(l.n[3]);
+			//Columns are all computed before any is stored, so stores into the result never force r to be reloaded
+			__m128 cols[4];
+			for (int j = 0; j < 4; j++) {
+				const __m128 rj = _mm_loadu_ps(r.n[j]);
+				__m128 col = _mm_mul_ps(c0, _mm_shuffle_ps(rj, rj, 0x00));
+				col = _mm_add_ps(col, _mm_mul_ps(c1, _mm_shuffle_ps(rj, rj, 0x55)));
+				col = _mm_add_ps(col, _mm_mul_ps(c2, _mm_shuffle_ps(rj, rj, 0xAA)));
+				col = _mm_add_ps(col, _mm_mul_ps(c3, _mm_shuffle_ps(rj, rj, 0xFF)));
+				cols[j] = col;
+			}
+			for (int j = 0; j < 4; j++) {
+				_mm_storeu_ps(m.n[j], cols[j]);
+			}
+#elif defined(EW_SIMD_NEON)
+			const float32x4_t c0 = vld1q_f32(l.n[0]);
+			const float32x4_t c1 = vld1q_f32(l.n[1]);
+			const float32x4_t c2 = vld1q_f32(l.n[2]);
+			const float32x4_t c3 = vld1q_f32(l.n[3]);
+			for (int j = 0; j < 4; j++) {
+				float32x4_t col = vmulq_n_f32(c0, r.n[j][0]);
+				col = vaddq_f32(col, vmulq_n_f32(c1, r.n[j][1]));
+				col = vaddq_f32(col, vmulq_n_f32(c2, r.n[j][2]));
+				col = vaddq_f32(col, vmulq_n_f32(c3, r.n[j][3]));
+				vst1q_f32(m.n[j], col);
+			}
+#else
 			//Row 0
 			m[0][0] = l[0][0] * r[0][0] + l[1][0] * r[0][1] + l[2][0] * r[0][2] + l[3][0] * r[0][3];//dot(l_row_0,r_col_0)
 			m[1][0] = l[0][0] * r[1][0] + l[1][0] * r[1][1] + l[2][0] * r[1][2] + l[3][0] * r[1][3];//dot(l_row_0,r_col_1)
 			m[2][0] = l[0][0] * r[2][0] + l[1][0] * r[2][1] + l[2][0] * r[2][2] + l[3][0] * r[2][3];//dot(l_row_0,r_col_2)
 			m[3][0] = l[0][0] * r[3][0] + l[1][0] * r[3][1] + l[2][0] * r[3][2] + l[3][0] * r[3][3];//dot(l_row_0,r_col_3)
-			// Row 1		  		    		  		    		  		    		  
+			// Row 1
 			m[0][1] = l[0][1] * r[0][0] + l[1][1] * r[0][1] + l[2][1] * r[0][2] + l[3][1] * r[0][3];//dot(l_row_1,r_col_0)
 			m[1][1] = l[0][1] * r[1][0] + l[1][1] * r[1][1] + l[2][1] * r[1][2] + l[3][1] * r[1][3];//dot(l_row_1,r_col_1)
 			m[2][1] = l[0][1] * r[2][0] + l[1][1] * r[2][1] + l[2][1] * r[2][2] + l[3][1] * r[2][3];//dot(l_row_1,r_col_2)
 			m[3][1] = l[0][1] * r[3][0] + l[1][1] * r[3][1] + l[2][1] * r[3][2] + l[3][1] * r[3][3];//dot(l_row_1,r_col_3)
-			// Row  2		  		    		  		    		  		    		  
+			// Row  2
 			m[0][2] = l[0][2] * r[0][0] + l[1][2] * r[0][1] + l[2][2] * r[0][2] + l[3][2] * r[0][3];//dot(l_row_2,r_col_0)
 			m[1][2] = l[0][2] * r[1][0] + l[1][2] * r[1][1] + l[2][2] * r[1][2] + l[3][2] * r[1][3];//dot(l_row_2,r_col_1)
 			m[2][2] = l[0][2] * r[2][0] + l[1][2] * r[2][1] + l[2][2] * r[2][2] + l[3][2] * r[2][3];//dot(l_row_2,r_col_2)
 			m[3][2] = l[0][2] * r[3][0] + l[1][2] * r[3][1] + l[2][2] * r[3][2] + l[3][2] * r[3][3];//dot(l_row_2,r_col_3)
-			// Row  3		 			 		 			 		 			 		    
+			// Row  3
 			m[0][3] = l[0][3] * r[0][0] + l[1][3] * r[0][1] + l[2][3] * r[0][2] + l[3][3] * r[0][3];//dot(l_row_3,r_col_0)
 			m[1][3] = l[0][3] * r[1][0] + l[1][3] * r[1][1] + l[2][3] * r[1][2] + l[3][3] * r[1][3];//dot(l_row_3,r_col_1)
 			m[2][3] = l[0][3] * r[2][0] + l[1][3] * r[2][1] + l[2][3] * r[2][2] + l[3][3] * r[2][3];//dot(l_row_3,r_col_2)
 			m[3][3] = l[0][3] * r[3][0] + l[1][3] * r[3][1] + l[2][3] * r[3][2] + l[3][3] * r[3][3];//dot(l_row_3,r_col_3)
-			return m;		  
+#endif
+			return m;
 		}
 	};
-	inline Mat4 IdentityMatrix() {
+	inline constexpr Mat4 IdentityMatrix() {
 		return Mat4(
 			1.0f, 0.0f, 0.0f, 0.0f,
 			0.0f, 1.0f, 0.0f, 0.0f,
@@ -82,4 +154,87 @@ namespace ew {
 			0.0f, 0.0f, 0.0f, 1.0f
 		);
 	}
+
+	inline constexpr Mat4 Transpose(const Mat4& m) {
+		//Rows of the result are the columns of m
+		return Mat4(
+			m.get(0, 0), m.get(0, 1), m.get(0, 2), m.get(0, 3),
+			m.get(1, 0), m.get(1, 1), m.get(1, 2), m.get(1, 3),
+			m.get(2, 0), m.get(2, 1), m.get(2, 2), m.get(2, 3),
+			m.get(3, 0), m.get(3, 1), m.get(3, 2), m.get(3, 3)
+		);
+	}
+
+	//Inverse of an affine matrix (bottom row 0,0,0,1), such as a model or view matrix.
+	//Handles non-uniform scale and shear. Much cheaper than the general Inverse.
+	inline Mat4 AffineInverse(const Mat4& m) {
+		const Vec3 c0 = m[0].toVec3();
+		const Vec3 c1 = m[1].toVec3();
+		const Vec3 c2 = m[2].toVec3();
+		const Vec3 t = m[3].toVec3();
+		//Rows of the inverse 3x3 are the cross products of the other two columns
+		Vec3 r0 = Cross(c1, c2);
+		Vec3 r1 = Cross(c2, c0);
+		Vec3 r2 = Cross(c0, c1);
+		const float det = Dot(c0, r0);
+		if (det != 0) {
+			const float invDet = 1.0f / det;
+			r0 *= invDet;
+			r1 *= invDet;
+			r2 *= invDet;
+		}
+		return Mat4(
+			r0.x, r0.y, r0.z, -Dot(r0, t),
+			r1.x, r1.y, r1.z, -Dot(r1, t),
+			r2.x, r2.y, r2.z, -Dot(r2, t),
+			0.0f, 0.0f, 0.0f, 1.0f
+		);
+	}
+
+	//General 4x4 inverse by cofactor expansion. Returns m unchanged if it is singular.
+	//Prefer AffineInverse when the bottom row is 0,0,0,1.
+	inline Mat4 Inverse(const Mat4& m) {
+		//2x2 sub-determinants of the two left and two right columns
+		const float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+		const float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+		const float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+		const float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+		const float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+		const float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+		const float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+		const float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+		const float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+		const float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+		const float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+		const float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+		const float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		if (det == 0) {
+			return m;
+		}
+		const float invDet = 1.0f / det;
+
+		Mat4 r;
+		r[0][0] = (m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * invDet;
+		r[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * invDet;
+		r[0][2] = (m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * invDet;
+		r[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * invDet;
+
+		r[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * invDet;
+		r[1][1] = (m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * invDet;
+		r[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * invDet;
+		r[1][3] = (m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * invDet;
+
+		r[2][0] = (m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * invDet;
+		r[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * invDet;
+		r[2][2] = (m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * invDet;
+		r[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * invDet;
+
+		r[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * invDet;
+		r[3][1] = (m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * invDet;
+		r[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * invDet;
+		r[3][3] = (m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * invDet;
+		return r;
+	}
 }
@@ -0,0 +1,527 @@
+#pragma once
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "simd.h"
+#include "vec3.h"
+
+//Packet math for structure-of-arrays kernels.
+//Float4 and Float8 hold 4 or 8 lanes of floats. Comparisons return masks of the same type with every bit of a
+//lane set (true) or clear (false), which feed Select, And/Or and MoveMask.
+//Float8 is a native AVX register when compiled with AVX, otherwise a pair of Float4.
+namespace ew {
+	struct Float4 {
+		static constexpr int WIDTH = 4;
+#if defined(EW_SIMD_SSE)
+		__m128 v;
+		Float4() = default;
+		Float4(__m128 v) :v(v) {};
+		Float4(float s) :v(_mm_set1_ps(s)) {};
+		static inline Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+		inline void store(float* p)const { _mm_storeu_ps(p, v); }
+#elif defined(EW_SIMD_NEON)
+		float32x4_t v;
+		Float4() = default;
+		Float4(float32x4_t v) :v(v) {};
+		Float4(float s) :v(vdupq_n_f32(s)) {};
+		static inline Float4 Load(const float* p) { return vld1q_f32(p); }
+		inline void store(float* p)const { vst1q_f32(p, v); }
+#else
+		float v[4];
+		Float4() = default;
+		Float4(float s) :v{ s, s, s, s } {};
+		static inline Float4 Load(const float* p) { Float4 r; memcpy(r.v, p, sizeof(r.v)); return r; }
+		inline void store(float* p)const { memcpy(p, v, sizeof(v)); }
+#endif
+		//Single lane, for debugging and tails. Slow
+		inline float lane(int i)const {
+			float tmp[WIDTH];
+			store(tmp);
+			return tmp[i];
+		}
+	};
+
+#if !defined(EW_SIMD_SSE) && !defined(EW_SIMD_NEON)
+	//Scalar fallback helpers
+	namespace packet_detail {
+		inline unsigned int bits(float f) { unsigned int u; memcpy(&u, &f, 4); return u; }
+		inline float fromBits(unsigned int u) { float f; memcpy(&f, &u, 4); return f; }
+		inline float mask(bool b) { return fromBits(b ? 0xFFFFFFFFu : 0u); }
+	}
+#define EW_FLOAT4_MAP(expr) Float4 r; for (int i = 0; i < 4; i++) { r.v[i] = (expr); } return r;
+#endif
+
+	inline Float4 operator+(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_add_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vaddq_f32(a.v, b.v);
+#else
+		EW_FLOAT4_MAP(a.v[i] + b.v[i])
+#endif
+	}
+	inline Float4 operator-(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_sub_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vsubq_f32(a.v, b.v);
+#else
+		EW_FLOAT4_MAP(a.v[i] - b.v[i])
+#endif
+	}
+	inline Float4 operator*(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_mul_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vmulq_f32(a.v, b.v);
+#else
+		EW_FLOAT4_MAP(a.v[i] * b.v[i])
+#endif
+	}
+	inline Float4 operator/(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_div_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON) && defined(__aarch64__)
+		return vdivq_f32(a.v, b.v);
+#else
+		float x[4], y[4];
+		a.store(x);
+		b.store(y);
+		for (int i = 0; i < 4; i++) {
+			x[i] /= y[i];
+		}
+		return Float4::Load(x);
+#endif
+	}
+	inline Float4 operator-(const Float4& a) {
+		return Float4(0.0f) - a;
+	}
+	//a * b + c. Fused when the target has FMA, so results may differ from a * b + c in the last bit
+	inline Float4 Madd(const Float4& a, const Float4& b, const Float4& c) {
+#if defined(EW_SIMD_SSE) && defined(__FMA__)
+		return _mm_fmadd_ps(a.v, b.v, c.v);
+#elif defined(EW_SIMD_NEON) && defined(__aarch64__)
+		return vfmaq_f32(c.v, a.v, b.v);
+#else
+		return a * b + c;
+#endif
+	}
+	inline Float4 Min(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_min_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vminq_f32(a.v, b.v);
+#else
+		EW_FLOAT4_MAP(a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+#endif
+	}
+	inline Float4 Max(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_max_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vmaxq_f32(a.v, b.v);
+#else
+		EW_FLOAT4_MAP(a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+#endif
+	}
+	inline Float4 Sqrt(const Float4& a) {
+#if defined(EW_SIMD_SSE)
+		return _mm_sqrt_ps(a.v);
+#elif defined(EW_SIMD_NEON) && defined(__aarch64__)
+		return vsqrtq_f32(a.v);
+#else
+		float x[4];
+		a.store(x);
+		for (int i = 0; i < 4; i++) {
+			x[i] = sqrtf(x[i]);
+		}
+		return Float4::Load(x);
+#endif
+	}
+	//Approximate 1/sqrt(a) refined with one Newton step. Relative error below 5e-6
+	inline Float4 Rsqrt(const Float4& a) {
+#if defined(EW_SIMD_SSE)
+		const __m128 y = _mm_rsqrt_ps(a.v);
+		//y * (1.5 - 0.5 * a * y * y)
+		const __m128 halfAYY = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), a.v), _mm_mul_ps(y, y));
+		return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), halfAYY));
+#elif defined(EW_SIMD_NEON)
+		float32x4_t y = vrsqrteq_f32(a.v);
+		y = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(a.v, y), y));
+		return vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(a.v, y), y));
+#else
+		EW_FLOAT4_MAP(1.0f / sqrtf(a.v[i]))
+#endif
+	}
+	inline Float4 Abs(const Float4& a) {
+#if defined(EW_SIMD_SSE)
+		return _mm_and_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+#elif defined(EW_SIMD_NEON)
+		return vabsq_f32(a.v);
+#else
+		EW_FLOAT4_MAP(fabsf(a.v[i]))
+#endif
+	}
+	//Rounds to the nearest integer, ties to even. Valid for |a| < 2^22
+	inline Float4 Round(const Float4& a) {
+#if defined(EW_SIMD_SSE) && defined(__SSE4_1__)
+		return _mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+#elif defined(EW_SIMD_NEON) && defined(__aarch64__)
+		return vrndnq_f32(a.v);
+#else
+		//Adding 1.5 * 2^23 pushes the fraction bits out of the mantissa
+		const Float4 magic(12582912.0f);
+		return (a + magic) - magic;
+#endif
+	}
+
+	//Comparisons, returning lane masks
+	inline Float4 CmpLt(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_cmplt_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vreinterpretq_f32_u32(vcltq_f32(a.v, b.v));
+#else
+		EW_FLOAT4_MAP(packet_detail::mask(a.v[i] < b.v[i]))
+#endif
+	}
+	inline Float4 CmpLe(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_cmple_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vreinterpretq_f32_u32(vcleq_f32(a.v, b.v));
+#else
+		EW_FLOAT4_MAP(packet_detail::mask(a.v[i] <= b.v[i]))
+#endif
+	}
+	inline Float4 CmpGt(const Float4& a, const Float4& b) {
+		return CmpLt(b, a);
+	}
+	inline Float4 CmpGe(const Float4& a, const Float4& b) {
+		return CmpLe(b, a);
+	}
+	inline Float4 CmpEq(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_cmpeq_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vreinterpretq_f32_u32(vceqq_f32(a.v, b.v));
+#else
+		EW_FLOAT4_MAP(packet_detail::mask(a.v[i] == b.v[i]))
+#endif
+	}
+
+	//Bitwise mask operations
+	inline Float4 And(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_and_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)));
+#else
+		EW_FLOAT4_MAP(packet_detail::fromBits(packet_detail::bits(a.v[i]) & packet_detail::bits(b.v[i])))
+#endif
+	}
+	inline Float4 Or(const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_or_ps(a.v, b.v);
+#elif defined(EW_SIMD_NEON)
+		return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)));
+#else
+		EW_FLOAT4_MAP(packet_detail::fromBits(packet_detail::bits(a.v[i]) | packet_detail::bits(b.v[i])))
+#endif
+	}
+	//Lanes of a where mask is set, b elsewhere
+	inline Float4 Select(const Float4& mask, const Float4& a, const Float4& b) {
+#if defined(EW_SIMD_SSE)
+		return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+#elif defined(EW_SIMD_NEON)
+		return vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v);
+#else
+		EW_FLOAT4_MAP(packet_detail::bits(mask.v[i]) ? a.v[i] : b.v[i])
+#endif
+	}
+	//Bit i is set if lane i of mask is set
+	inline int MoveMask(const Float4& mask) {
+#if defined(EW_SIMD_SSE)
+		return _mm_movemask_ps(mask.v);
+#else
+		float m[4];
+		mask.store(m);
+		int bitsOut = 0;
+		for (int i = 0; i < 4; i++) {
+			unsigned int u;
+			memcpy(&u, &m[i], 4);
+			bitsOut |= (u >> 31) << i;
+		}
+		return bitsOut;
+#endif
+	}
+#undef EW_FLOAT4_MAP
+	//Transposes the 4x4 matrix whose rows are a, b, c, d, e.g. 4 components of 4 elements into 4 elements of 4 components
+	inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d) {
+#if defined(EW_SIMD_SSE)
+		_MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+#elif defined(EW_SIMD_NEON)
+		const float32x4x2_t ab = vtrnq_f32(a.v, b.v);
+		const float32x4x2_t cd = vtrnq_f32(c.v, d.v);
+		a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+		b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+		c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+		d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+#else
+		Float4* rows[4] = { &a, &b, &c, &d };
+		for (int i = 0; i < 4; i++) {
+			for (int j = i + 1; j < 4; j++) {
+				const float tmp = rows[i]->v[j];
+				rows[i]->v[j] = rows[j]->v[i];
+				rows[j]->v[i] = tmp;
+			}
+		}
+#endif
+	}
+
+	struct Float8 {
+		static constexpr int WIDTH = 8;
+#if defined(EW_SIMD_AVX)
+		__m256 v;
+		Float8() = default;
+		Float8(__m256 v) :v(v) {};
+		Float8(float s) :v(_mm256_set1_ps(s)) {};
+		static inline Float8 Load(const float* p) { return _mm256_loadu_ps(p); }
+		inline void store(float* p)const { _mm256_storeu_ps(p, v); }
+#else
+		Float4 lo, hi;
+		Float8() = default;
+		Float8(const Float4& lo, const Float4& hi) :lo(lo), hi(hi) {};
+		Float8(float s) :lo(s), hi(s) {};
+		static inline Float8 Load(const float* p) { return Float8(Float4::Load(p), Float4::Load(p + 4)); }
+		inline void store(float* p)const { lo.store(p); hi.store(p + 4); }
+#endif
+		//Single lane, for debugging and tails. Slow
+		inline float lane(int i)const {
+			float tmp[WIDTH];
+			store(tmp);
+			return tmp[i];
+		}
+	};
+
+#if defined(EW_SIMD_AVX)
+#define EW_FLOAT8_BINARY(name, avx) inline Float8 name(const Float8& a, const Float8& b) { return avx(a.v, b.v); }
+#define EW_FLOAT8_UNARY(name, expr) inline Float8 name(const Float8& a) { return expr; }
+#else
+#define EW_FLOAT8_BINARY(name, avx) inline Float8 name(const Float8& a, const Float8& b) { return Float8(name(a.lo, b.lo), name(a.hi, b.hi)); }
+#define EW_FLOAT8_UNARY(name, expr) inline Float8 name(const Float8& a) { return Float8(name(a.lo), name(a.hi)); }
+#endif
+	EW_FLOAT8_BINARY(operator+, _mm256_add_ps)
+	EW_FLOAT8_BINARY(operator-, _mm256_sub_ps)
+	EW_FLOAT8_BINARY(operator*, _mm256_mul_ps)
+	EW_FLOAT8_BINARY(operator/, _mm256_div_ps)
+	EW_FLOAT8_BINARY(Min, _mm256_min_ps)
+	EW_FLOAT8_BINARY(Max, _mm256_max_ps)
+	EW_FLOAT8_BINARY(And, _mm256_and_ps)
+	EW_FLOAT8_BINARY(Or, _mm256_or_ps)
+	EW_FLOAT8_UNARY(Sqrt, _mm256_sqrt_ps(a.v))
+	EW_FLOAT8_UNARY(Abs, _mm256_and_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF))))
+	EW_FLOAT8_UNARY(Round, _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC))
+#undef EW_FLOAT8_BINARY
+#undef EW_FLOAT8_UNARY
+
+	inline Float8 operator-(const Float8& a) {
+		return Float8(0.0f) - a;
+	}
+	inline Float8 Madd(const Float8& a, const Float8& b, const Float8& c) {
+#if defined(EW_SIMD_AVX) && defined(__FMA__)
+		return _mm256_fmadd_ps(a.v, b.v, c.v);
+#elif defined(EW_SIMD_AVX)
+		return a * b + c;
+#else
+		return Float8(Madd(a.lo, b.lo, c.lo), Madd(a.hi, b.hi, c.hi));
+#endif
+	}
+	inline Float8 Rsqrt(const Float8& a) {
+#if defined(EW_SIMD_AVX)
+		const __m256 y = _mm256_rsqrt_ps(a.v);
+		const __m256 halfAYY = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), a.v), _mm256_mul_ps(y, y));
+		return _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), halfAYY));
+#else
+		return Float8(Rsqrt(a.lo), Rsqrt(a.hi));
+#endif
+	}
+#if defined(EW_SIMD_AVX)
+	inline Float8 CmpLt(const Float8& a, const Float8& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+	inline Float8 CmpLe(const Float8& a, const Float8& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+	inline Float8 CmpEq(const Float8& a, const Float8& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+	//Not _mm256_blendv_ps, which GCC folds into per lane sign tests and scalarizes without AVX2
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { return _mm256_or_ps(_mm256_and_ps(mask.v, a.v), _mm256_andnot_ps(mask.v, b.v)); }
+	inline int MoveMask(const Float8& mask) { return _mm256_movemask_ps(mask.v); }
+#else
+	inline Float8 CmpLt(const Float8& a, const Float8& b) { return Float8(CmpLt(a.lo, b.lo), CmpLt(a.hi, b.hi)); }
+	inline Float8 CmpLe(const Float8& a, const Float8& b) { return Float8(CmpLe(a.lo, b.lo), CmpLe(a.hi, b.hi)); }
+	inline Float8 CmpEq(const Float8& a, const Float8& b) { return Float8(CmpEq(a.lo, b.lo), CmpEq(a.hi, b.hi)); }
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { return Float8(Select(mask.lo, a.lo, b.lo), Select(mask.hi, a.hi, b.hi)); }
+	inline int MoveMask(const Float8& mask) { return MoveMask(mask.lo) | (MoveMask(mask.hi) << 4); }
+#endif
+	inline Float8 CmpGt(const Float8& a, const Float8& b) {
+		return CmpLt(b, a);
+	}
+	inline Float8 CmpGe(const Float8& a, const Float8& b) {
+		return CmpLe(b, a);
+	}
+	//Transposes the 8x8 matrix whose rows are rows[0..7]
+	inline void Transpose(Float8 rows[8]) {
+#if defined(EW_SIMD_AVX)
+		__m256 t[8], u[8];
+		for (int i = 0; i < 8; i += 2) {
+			t[i] = _mm256_unpacklo_ps(rows[i].v, rows[i + 1].v);
+			t[i + 1] = _mm256_unpackhi_ps(rows[i].v, rows[i + 1].v);
+		}
+		for (int i = 0; i < 8; i += 4) {
+			u[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+			u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+			u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+			u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+		}
+		for (int i = 0; i < 4; i++) {
+			rows[i].v = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+			rows[i + 4].v = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+		}
+#else
+		//Transpose the four 4x4 blocks, then swap the off diagonal ones
+		Transpose(rows[0].lo, rows[1].lo, rows[2].lo, rows[3].lo);
+		Transpose(rows[0].hi, rows[1].hi, rows[2].hi, rows[3].hi);
+		Transpose(rows[4].lo, rows[5].lo, rows[6].lo, rows[7].lo);
+		Transpose(rows[4].hi, rows[5].hi, rows[6].hi, rows[7].hi);
+		for (int i = 0; i < 4; i++) {
+			const Float4 tmp = rows[i].hi;
+			rows[i].hi = rows[i + 4].lo;
+			rows[i + 4].lo = tmp;
+		}
+#endif
+	}
+
+	//Lane i holds start + i
+	template <typename F>
+	inline F LaneRamp(float start) {
+		static const float RAMP[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+		return F(start) + F::Load(RAMP);
+	}
+
+	//Rounds down to an integer. Valid for |a| < 2^22
+	template <typename F>
+	inline F Floor(const F& a) {
+		const F r = Round(a);
+		return r - Select(CmpGt(r, a), F(1.0f), F(0.0f));
+	}
+
+	//F::WIDTH Vec3s in structure-of-arrays form. Use through Vec3x4 and Vec3x8
+	template <typename F>
+	struct Vec3xN {
+		static constexpr int WIDTH = F::WIDTH;
+		F x, y, z;
+
+		Vec3xN() = default;
+		Vec3xN(const F& x, const F& y, const F& z) :x(x), y(y), z(z) {};
+		//Same vector in every lane
+		explicit Vec3xN(const ew::Vec3& v) :x(v.x), y(v.y), z(v.z) {};
+
+		//Loads WIDTH elements from separate x, y and z arrays
+		static inline Vec3xN Load(const float* xs, const float* ys, const float* zs) {
+			return Vec3xN(F::Load(xs), F::Load(ys), F::Load(zs));
+		}
+		inline void store(float* xs, float* ys, float* zs)const {
+			x.store(xs);
+			y.store(ys);
+			z.store(zs);
+		}
+		//Loads WIDTH Vec3s that are strideBytes apart, e.g. &vertices[0].pos with sizeof(Vertex)
+		static inline Vec3xN Gather(const ew::Vec3* first, size_t strideBytes = sizeof(ew::Vec3)) {
+			float xs[WIDTH], ys[WIDTH], zs[WIDTH];
+			const unsigned char* p = reinterpret_cast<const unsigned char*>(first);
+			for (int i = 0; i < WIDTH; i++, p += strideBytes) {
+				const ew::Vec3& v = *reinterpret_cast<const ew::Vec3*>(p);
+				xs[i] = v.x;
+				ys[i] = v.y;
+				zs[i] = v.z;
+			}
+			return Load(xs, ys, zs);
+		}
+		//Stores WIDTH Vec3s that are strideBytes apart
+		inline void scatter(ew::Vec3* first, size_t strideBytes = sizeof(ew::Vec3))const {
+			float xs[WIDTH], ys[WIDTH], zs[WIDTH];
+			store(xs, ys, zs);
+			unsigned char* p = reinterpret_cast<unsigned char*>(first);
+			for (int i = 0; i < WIDTH; i++, p += strideBytes) {
+				*reinterpret_cast<ew::Vec3*>(p) = ew::Vec3(xs[i], ys[i], zs[i]);
+			}
+		}
+	};
+	typedef Vec3xN<Float4> Vec3x4;
+	typedef Vec3xN<Float8> Vec3x8;
+
+	template <typename F>
+	inline Vec3xN<F> operator+(const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Vec3xN<F>(a.x + b.x, a.y + b.y, a.z + b.z);
+	}
+	template <typename F>
+	inline Vec3xN<F> operator-(const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Vec3xN<F>(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+	template <typename F>
+	inline Vec3xN<F> operator-(const Vec3xN<F>& a) {
+		return Vec3xN<F>(-a.x, -a.y, -a.z);
+	}
+	//Component-wise product
+	template <typename F>
+	inline Vec3xN<F> operator*(const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Vec3xN<F>(a.x * b.x, a.y * b.y, a.z * b.z);
+	}
+	//Scales each lane by the matching lane of s
+	template <typename F>
+	inline Vec3xN<F> operator*(const Vec3xN<F>& a, const F& s) {
+		return Vec3xN<F>(a.x * s, a.y * s, a.z * s);
+	}
+	template <typename F>
+	inline Vec3xN<F> operator*(const F& s, const Vec3xN<F>& a) {
+		return a * s;
+	}
+	//a * s + c
+	template <typename F>
+	inline Vec3xN<F> Madd(const Vec3xN<F>& a, const F& s, const Vec3xN<F>& c) {
+		return Vec3xN<F>(Madd(a.x, s, c.x), Madd(a.y, s, c.y), Madd(a.z, s, c.z));
+	}
+	template <typename F>
+	inline F Dot(const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Madd(a.z, b.z, Madd(a.y, b.y, a.x * b.x));
+	}
+	template <typename F>
+	inline Vec3xN<F> Cross(const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Vec3xN<F>(
+			a.y * b.z - a.z * b.y,
+			a.z * b.x - a.x * b.z,
+			a.x * b.y - a.y * b.x
+		);
+	}
+	template <typename F>
+	inline F Magnitude(const Vec3xN<F>& v) {
+		return Sqrt(Dot(v, v));
+	}
+	//Normalizes with the fast Rsqrt. Zero length lanes are returned unchanged
+	template <typename F>
+	inline Vec3xN<F> Normalize(const Vec3xN<F>& v) {
+		const F lengthSq = Dot(v, v);
+		const F scale = Select(CmpGt(lengthSq, F(0.0f)), Rsqrt(lengthSq), F(1.0f));
+		return v * scale;
+	}
+	template <typename F>
+	inline Vec3xN<F> Min(const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Vec3xN<F>(Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z));
+	}
+	template <typename F>
+	inline Vec3xN<F> Max(const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Vec3xN<F>(Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z));
+	}
+	//Lanes of a where mask is set, b elsewhere
+	template <typename F>
+	inline Vec3xN<F> Select(const F& mask, const Vec3xN<F>& a, const Vec3xN<F>& b) {
+		return Vec3xN<F>(Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z));
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <math.h>
+#include "sqrt.h"
+#include "vec3.h"
+#include "mat4.h"
+
+namespace ew {
+	//Unit quaternion rotation. (x,y,z) is the vector part, w the scalar part
+	struct Quat {
+		float x, y, z, w;
+
+		constexpr Quat() :x(0), y(0), z(0), w(1) {};
+		constexpr Quat(float x, float y, float z, float w) :x(x), y(y), z(z), w(w) {};
+
+		//Operator overloads
+		constexpr Quat& operator*=(const Quat& rhs);
+		friend constexpr Quat operator*(Quat lhs, const Quat& rhs);
+		friend constexpr Quat operator*(const Quat& lhs, float rhs);
+		friend constexpr Quat operator+(const Quat& lhs, const Quat& rhs);
+		friend constexpr Quat operator-(const Quat& rhs);
+	};
+
+	//Hamilton product. lhs * rhs applies rhs first, then lhs
+	inline constexpr Quat& Quat::operator*=(const Quat& rhs) {
+		const Quat l = *this;
+		this->x = l.w * rhs.x + l.x * rhs.w + l.y * rhs.z - l.z * rhs.y;
+		this->y = l.w * rhs.y - l.x * rhs.z + l.y * rhs.w + l.z * rhs.x;
+		this->z = l.w * rhs.z + l.x * rhs.y - l.y * rhs.x + l.z * rhs.w;
+		this->w = l.w * rhs.w - l.x * rhs.x - l.y * rhs.y - l.z * rhs.z;
+		return *this;
+	}
+
+	inline constexpr Quat operator*(Quat lhs, const Quat& rhs)
+	{
+		lhs *= rhs;
+		return lhs;
+	}
+
+	inline constexpr Quat operator*(const Quat& lhs, float rhs)
+	{
+		return Quat(lhs.x * rhs, lhs.y * rhs, lhs.z * rhs, lhs.w * rhs);
+	}
+
+	inline constexpr Quat operator+(const Quat& lhs, const Quat& rhs)
+	{
+		return Quat(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z, lhs.w + rhs.w);
+	}
+
+	inline constexpr Quat operator-(const Quat& rhs)
+	{
+		return Quat(-rhs.x, -rhs.y, -rhs.z, -rhs.w);
+	}
+
+	//Utility functions
+	inline constexpr float Dot(const Quat& a, const Quat& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	}
+
+	inline constexpr float Magnitude(const Quat& q)
+	{
+		return ew::Sqrt(Dot(q, q));
+	}
+
+	inline constexpr Quat Normalize(const Quat& q)
+	{
+		float mag = Magnitude(q);
+		if (mag == 0)
+			return Quat();
+		return q * (1.0f / mag);
+	}
+
+	//Inverse rotation of a unit quaternion
+	inline constexpr Quat Conjugate(const Quat& q) {
+		return Quat(-q.x, -q.y, -q.z, q.w);
+	}
+
+	//Rotation of rad radians around a normalized axis
+	inline Quat AxisAngle(const Vec3& axis, float rad) {
+		const float s = sinf(rad * 0.5f);
+		return Quat(axis.x * s, axis.y * s, axis.z * s, cosf(rad * 0.5f));
+	}
+
+	//Rotates v by q
+	inline Vec3 Rotate(const Quat& q, const Vec3& v) {
+		//v + 2w(u x v) + 2u x (u x v)
+		const Vec3 u(q.x, q.y, q.z);
+		const Vec3 t = Cross(u, v) * 2.0f;
+		return v + t * q.w + Cross(u, t);
+	}
+
+	//Normalized linear interpolation. Cheap, but angular speed is not constant
+	inline Quat Nlerp(const Quat& a, const Quat& b, float t) {
+		//Take the shortest path
+		const Quat end = Dot(a, b) < 0 ? -b : b;
+		return Normalize(a * (1.0f - t) + end * t);
+	}
+
+	//Spherical linear interpolation at constant angular speed
+	inline Quat Slerp(const Quat& a, const Quat& b, float t) {
+		float cosAngle = Dot(a, b);
+		Quat end = b;
+		if (cosAngle < 0) {
+			cosAngle = -cosAngle;
+			end = -b;
+		}
+		//Nearly parallel, sin(angle) approaches 0
+		if (cosAngle > 0.9995f) {
+			return Nlerp(a, end, t);
+		}
+		const float angle = acosf(cosAngle);
+		const float invSin = 1.0f / sinf(angle);
+		return a * (sinf((1.0f - t) * angle) * invSin) + end * (sinf(t * angle) * invSin);
+	}
+
+	//Rotation matrix of a unit quaternion
+	inline constexpr Mat4 ToMat4(const Quat& q) {
+		const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+		return Mat4(
+			1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy), 0.0f,
+			2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx), 0.0f,
+			2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		);
+	}
+
+	//Translate(t) * ToMat4(q) * Scale(s), built in closed form
+	inline constexpr Mat4 TRS(const Vec3& t, const Quat& q, const Vec3& s) {
+		const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+		return Mat4(
+			(1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy - wz) * s.y, 2.0f * (xz + wy) * s.z, t.x,
+			2.0f * (xy + wz) * s.x, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz - wx) * s.z, t.y,
+			2.0f * (xz - wy) * s.x, 2.0f * (yz + wx) * s.y, (1.0f - 2.0f * (xx + yy)) * s.z, t.z,
+			0.0f, 0.0f, 0.0f, 1.0f
+		);
+	}
+
+	//Euler angles (radians) to quaternion, matching RotateY * RotateX * RotateZ
+	inline Quat QuatFromEuler(const Vec3& rad) {
+		const float sx = sinf(rad.x * 0.5f), cx = cosf(rad.x * 0.5f);
+		const float sy = sinf(rad.y * 0.5f), cy = cosf(rad.y * 0.5f);
+		const float sz = sinf(rad.z * 0.5f), cz = cosf(rad.z * 0.5f);
+		return Quat(
+			cy * sx * cz + sy * cx * sz,
+			sy * cx * cz - cy * sx * sz,
+			cy * cx * sz - sy * sx * cz,
+			cy * cx * cz + sy * sx * sz
+		);
+	}
+
+	//Quaternion to Euler angles (radians), inverse of QuatFromEuler
+	inline Vec3 ToEuler(const Quat& q) {
+		const Mat4 m = ToMat4(q);
+		//m[col][row]. Row 1, column 2 of RotateY * RotateX * RotateZ is -sin(x)
+		const float sinX = -m[2][1];
+		//Column 2 is (sin(y)cos(x), -sin(x), cos(y)cos(x)), so yaw and roll stay recoverable until cos(x) is tiny
+		const float cosX = sqrtf(m[2][0] * m[2][0] + m[2][2] * m[2][2]);
+		if (cosX > 1e-6f) {
+			return Vec3(atan2f(sinX, cosX), atan2f(m[2][0], m[2][2]), atan2f(m[0][1], m[1][1]));
+		}
+		//Gimbal lock, fold roll into yaw
+		const float x = sinX > 0 ? 1.5707963267948966f : -1.5707963267948966f;
+		return Vec3(x, atan2f(-m[0][2], m[0][0]), 0.0f);
+	}
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "vec3.h"
+#include "packet.h"
+#include "fastTrig.h"
+
+//Seedable random numbers.
+//Rng is PCG32 (O'Neill, XSH RR variant). It has 64 bits of state plus a stream selector, so two generators with the
+//same seed and different streams produce different sequences. Give each thread or each chunk of a
+//ParallelFor its own stream to get reproducible results regardless of scheduling.
+//Bulk fills seed a 4 lane xoshiro128+ generator from the Rng and produce 4 floats per step. The output
+//depends only on the Rng state and is identical on every SIMD backend.
+namespace ew {
+	namespace random_detail {
+		//Top 23 bits of u as a float in [0, 1)
+		inline float ToUnitFloat(uint32_t u) {
+			const uint32_t bits = (u >> 9) | 0x3F800000u;
+			float f;
+			memcpy(&f, &bits, 4);
+			return f - 1.0f;
+		}
+	}
+
+	struct Rng {
+		static constexpr uint64_t DEFAULT_SEED = 0x853C49E6748FEA9Bull;
+
+		explicit Rng(uint64_t seed = DEFAULT_SEED, uint64_t stream = 0) {
+			this->seed(seed, stream);
+		}
+		//Restarts the sequence. Every (seed, stream) pair is an independent sequence
+		inline void seed(uint64_t seed, uint64_t stream = 0) {
+			m_state = 0;
+			m_inc = (stream << 1) | 1u;
+			nextUInt();
+			m_state += seed;
+			nextUInt();
+		}
+		//Uniform 32 bit integer
+		inline uint32_t nextUInt() {
+			const uint64_t old = m_state;
+			m_state = old * 6364136223846793005ull + m_inc;
+			const uint32_t xorShifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+			const uint32_t rot = (uint32_t)(old >> 59u);
+			return (xorShifted >> rot) | (xorShifted << ((0u - rot) & 31u));
+		}
+		//Uniform integer in [0, bound), without modulo bias
+		inline uint32_t nextUInt(uint32_t bound) {
+			if (bound == 0)
+				return 0;
+			const uint32_t threshold = (0u - bound) % bound;
+			for (;;) {
+				const uint32_t r = nextUInt();
+				if (r >= threshold)
+					return r % bound;
+			}
+		}
+		//Uniform float in [0, 1)
+		inline float nextFloat() {
+			return random_detail::ToUnitFloat(nextUInt());
+		}
+		//Uniform float in [min, max)
+		inline float range(float min, float max) {
+			return min + (max - min) * nextFloat();
+		}
+		//Uniform integer in [min, max]
+		inline int rangeInt(int min, int max) {
+			return min + (int)nextUInt((uint32_t)(max - min) + 1u);
+		}
+		//Uniform point in the box [min, max)
+		inline Vec3 range(const Vec3& min, const Vec3& max) {
+			const float x = range(min.x, max.x);
+			const float y = range(min.y, max.y);
+			return Vec3(x, y, range(min.z, max.z));
+		}
+		//Uniform direction
+		inline Vec3 onUnitSphere() {
+			const float z = nextFloat() * 2.0f - 1.0f;
+			const float r = sqrtf(fmaxf(0.0f, 1.0f - z * z));
+			float s, c;
+			FastSinCos(nextFloat() * 6.283185307179586f, &s, &c);
+			return Vec3(r * c, r * s, z);
+		}
+		//Uniform point inside the unit ball
+		inline Vec3 insideUnitSphere() {
+			//Rejection accepts about 52% of samples, cheaper on average than cbrt
+			for (;;) {
+				const float x = nextFloat() * 2.0f - 1.0f;
+				const float y = nextFloat() * 2.0f - 1.0f;
+				const float z = nextFloat() * 2.0f - 1.0f;
+				if (x * x + y * y + z * z <= 1.0f)
+					return Vec3(x, y, z);
+			}
+		}
+
+		//Bulk fills. Each call advances this generator by a fixed amount, independent of count
+		inline void fill(float* out, size_t count, float min, float max);
+		inline void fill(Vec3* out, size_t count, const Vec3& min, const Vec3& max);
+		inline void fillOnUnitSphere(Vec3* out, size_t count);
+
+	private:
+		uint64_t m_state;
+		uint64_t m_inc;
+	};
+
+	namespace random_detail {
+		//4 independent xoshiro128+ generators, one per lane. Only the top bits are used, which avoids
+		//the weak low bits of the + scrambler
+		struct Xoshiro128x4 {
+#if defined(EW_SIMD_SSE)
+			__m128i s0, s1, s2, s3;
+			explicit Xoshiro128x4(Rng& rng) {
+				uint32_t s[16];
+				seedWords(rng, s);
+				s0 = _mm_loadu_si128((const __m128i*)(s + 0));
+				s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+				s2 = _mm_loadu_si128((const __m128i*)(s + 8));
+				s3 = _mm_loadu_si128((const __m128i*)(s + 12));
+			}
+			//Uniform floats in [0, 1)
+			inline Float4 nextFloat4() {
+				const __m128i result = _mm_add_epi32(s0, s3);
+				const __m128i t = _mm_slli_epi32(s1, 9);
+				s2 = _mm_xor_si128(s2, s0);
+				s3 = _mm_xor_si128(s3, s1);
+				s1 = _mm_xor_si128(s1, s2);
+				s0 = _mm_xor_si128(s0, s3);
+				s2 = _mm_xor_si128(s2, t);
+				s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+				const __m128i bits = _mm_or_si128(_mm_srli_epi32(result, 9), _mm_set1_epi32(0x3F800000));
+				return _mm_sub_ps(_mm_castsi128_ps(bits), _mm_set1_ps(1.0f));
+			}
+#elif defined(EW_SIMD_NEON)
+			uint32x4_t s0, s1, s2, s3;
+			explicit Xoshiro128x4(Rng& rng) {
+				uint32_t s[16];
+				seedWords(rng, s);
+				s0 = vld1q_u32(s + 0);
+				s1 = vld1q_u32(s + 4);
+				s2 = vld1q_u32(s + 8);
+				s3 = vld1q_u32(s + 12);
+			}
+			inline Float4 nextFloat4() {
+				const uint32x4_t result = vaddq_u32(s0, s3);
+				const uint32x4_t t = vshlq_n_u32(s1, 9);
+				s2 = veorq_u32(s2, s0);
+				s3 = veorq_u32(s3, s1);
+				s1 = veorq_u32(s1, s2);
+				s0 = veorq_u32(s0, s3);
+				s2 = veorq_u32(s2, t);
+				s3 = vorrq_u32(vshlq_n_u32(s3, 11), vshrq_n_u32(s3, 21));
+				const uint32x4_t bits = vorrq_u32(vshrq_n_u32(result, 9), vdupq_n_u32(0x3F800000u));
+				return vsubq_f32(vreinterpretq_f32_u32(bits), vdupq_n_f32(1.0f));
+			}
+#else
+			uint32_t s[4][4];
+			explicit Xoshiro128x4(Rng& rng) {
+				seedWords(rng, &s[0][0]);
+			}
+			inline Float4 nextFloat4() {
+				Float4 r;
+				for (int i = 0; i < 4; i++) {
+					const uint32_t result = s[0][i] + s[3][i];
+					const uint32_t t = s[1][i] << 9;
+					s[2][i] ^= s[0][i];
+					s[3][i] ^= s[1][i];
+					s[1][i] ^= s[2][i];
+					s[0][i] ^= s[3][i];
+					s[2][i] ^= t;
+					s[3][i] = (s[3][i] << 11) | (s[3][i] >> 21);
+					r.v[i] = ToUnitFloat(result);
+				}
+				return r;
+			}
+#endif
+			//Words are laid out as s0[4], s1[4], s2[4], s3[4]
+			static inline void seedWords(Rng& rng, uint32_t* s) {
+				for (int i = 0; i < 16; i++) {
+					s[i] = rng.nextUInt();
+				}
+				//An all zero lane would stay zero forever
+				for (int lane = 0; lane < 4; lane++) {
+					if ((s[lane] | s[4 + lane] | s[8 + lane] | s[12 + lane]) == 0)
+						s[lane] = 1;
+				}
+			}
+		};
+
+		//Writes the first count lanes of v
+		inline void StorePartial(const Float4& v, float* out, size_t count) {
+			float tmp[4];
+			v.store(tmp);
+			for (size_t i = 0; i < count; i++) {
+				out[i] = tmp[i];
+			}
+		}
+	}
+
+	inline void Rng::fill(float* out, size_t count, float min, float max) {
+		random_detail::Xoshiro128x4 gen(*this);
+		const Float4 base(min), scale(max - min);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			(base + gen.nextFloat4() * scale).store(out + i);
+		}
+		if (i < count) {
+			random_detail::StorePartial(base + gen.nextFloat4() * scale, out + i, count - i);
+		}
+	}
+
+	inline void Rng::fill(Vec3* out, size_t count, const Vec3& min, const Vec3& max) {
+		static_assert(sizeof(Vec3) == 3 * sizeof(float), "Vec3 must be tightly packed");
+		random_detail::Xoshiro128x4 gen(*this);
+		//4 Vec3s are 12 floats, or 3 packets with the components rotating xyzx yzxy zxyz
+		const Vec3 ext = max - min;
+		const float baseLanes[12] = { min.x, min.y, min.z, min.x, min.y, min.z, min.x, min.y, min.z, min.x, min.y, min.z };
+		const float scaleLanes[12] = { ext.x, ext.y, ext.z, ext.x, ext.y, ext.z, ext.x, ext.y, ext.z, ext.x, ext.y, ext.z };
+		const Float4 base[3] = { Float4::Load(baseLanes), Float4::Load(baseLanes + 4), Float4::Load(baseLanes + 8) };
+		const Float4 scale[3] = { Float4::Load(scaleLanes), Float4::Load(scaleLanes + 4), Float4::Load(scaleLanes + 8) };
+		float* floats = &out[0].x;
+		const size_t floatCount = count * 3;
+		size_t i = 0;
+		for (; i + 12 <= floatCount; i += 12) {
+			(base[0] + gen.nextFloat4() * scale[0]).store(floats + i);
+			(base[1] + gen.nextFloat4() * scale[1]).store(floats + i + 4);
+			(base[2] + gen.nextFloat4() * scale[2]).store(floats + i + 8);
+		}
+		for (int p = 0; i < floatCount; p++, i += 4) {
+			const size_t n = floatCount - i < 4 ? floatCount - i : 4;
+			random_detail::StorePartial(base[p] + gen.nextFloat4() * scale[p], floats + i, n);
+		}
+	}
+
+	inline void Rng::fillOnUnitSphere(Vec3* out, size_t count) {
+		random_detail::Xoshiro128x4 gen(*this);
+		size_t i = 0;
+		for (; i < count; i += 4) {
+			const Float4 z = gen.nextFloat4() * Float4(2.0f) - Float4(1.0f);
+			const Float4 r = Sqrt(Max(Float4(0.0f), Float4(1.0f) - z * z));
+			Float4 s, c;
+			FastSinCos(gen.nextFloat4() * Float4(6.283185307179586f), &s, &c);
+			const Vec3x4 dir(r * c, r * s, z);
+			if (i + 4 <= count) {
+				dir.scatter(out + i);
+			}
+			else {
+				for (size_t j = 0; i + j < count; j++) {
+					out[i + j] = Vec3(dir.x.lane((int)j), dir.y.lane((int)j), dir.z.lane((int)j));
+				}
+			}
+		}
+	}
+
+	//Generator owned by the calling thread. Each thread gets its own stream of the default seed, assigned in the
+	//order threads first call this. Use an explicit Rng(seed, stream) when results must be reproducible
+	inline Rng& ThreadRng() {
+		static std::atomic<uint64_t> nextStream(0);
+		thread_local Rng rng(Rng::DEFAULT_SEED, nextStream.fetch_add(1, std::memory_order_relaxed));
+		return rng;
+	}
+}
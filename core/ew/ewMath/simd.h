@@ -0,0 +1,36 @@
+#pragma once
+
+//SIMD backend selection for ewMath kernels.
+//The backend is picked at compile time from the target flags. Every kernel keeps a scalar fallback.
+//Mat4 kernels perform the same operations in the same order on every backend, so results are bit-identical.
+//Packet helpers that approximate (Rsqrt, fused Madd) say so where they are declared.
+//Define EW_NO_SIMD before including any ewMath header to force the scalar path.
+#if !defined(EW_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define EW_SIMD_SSE 1
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#if defined(__AVX__)
+#define EW_SIMD_AVX 1
+#include <immintrin.h>
+#endif
+#elif !defined(EW_NO_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define EW_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace ew {
+	//Name of the active SIMD backend, useful for logging
+	inline const char* SimdBackendName() {
+#if defined(EW_SIMD_AVX)
+		return "AVX";
+#elif defined(EW_SIMD_SSE)
+		return "SSE2";
+#elif defined(EW_SIMD_NEON)
+		return "NEON";
+#else
+		return "Scalar";
+#endif
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <math.h>
+
+//EW_IS_CONSTANT_EVALUATED() is true while a constexpr function is being folded by the compiler
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define EW_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+#endif
+#if !defined(EW_HAS_IS_CONSTANT_EVALUATED) && ((defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+#define EW_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+
+#if defined(EW_HAS_IS_CONSTANT_EVALUATED)
+#define EW_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+//Without compiler support, constexpr helpers always take their constexpr path
+#define EW_IS_CONSTANT_EVALUATED() true
+#endif
+
+namespace ew {
+	//Square root by Newton's method, usable in constant expressions. Within 1 ulp of sqrtf
+	constexpr float ConstexprSqrt(float x) {
+		//0, negative, NaN and infinity
+		if (!(x > 0.0f) || x > 3.402823e38f) {
+			return x == 0.0f ? x : (x > 0.0f ? x : NAN);
+		}
+		//Scale into [1,4) by powers of 4 so a fixed number of iterations converges
+		float scale = 1.0f;
+		while (x >= 4.0f) {
+			x *= 0.25f;
+			scale *= 2.0f;
+		}
+		while (x < 1.0f) {
+			x *= 4.0f;
+			scale *= 0.5f;
+		}
+		float r = (x + 1.0f) * 0.5f;
+		for (int i = 0; i < 5; i++) {
+			r = 0.5f * (r + x / r);
+		}
+		return r * scale;
+	}
+
+	//sqrtf at runtime, ConstexprSqrt when folded at compile time
+	constexpr float Sqrt(float x) {
+		if (EW_IS_CONSTANT_EVALUATED()) {
+			return ConstexprSqrt(x);
+		}
+		return sqrtf(x);
+	}
+}
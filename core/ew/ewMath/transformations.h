@@ -5,10 +5,11 @@
 #pragma once
 #include "mat4.h"
 #include "vec3.h"
+#include "fastTrig.h"
 
 namespace ew {
 	//Identity matrix
-	inline ew::Mat4 Identity() {
+	inline constexpr ew::Mat4 Identity() {
 		return ew::Mat4(
 			1, 0, 0, 0,
 			0, 1, 0, 0,
@@ -17,7 +18,7 @@ namespace ew {
 		);
 	};
 	//Scale on x,y,z axes
-	inline ew::Mat4 Scale(const ew::Vec3& s) {
+	inline constexpr ew::Mat4 Scale(const ew::Vec3& s) {
 		return ew::Mat4(
 			s.x, 0, 0, 0,
 			0, s.y, 0, 0,
@@ -27,8 +28,8 @@ namespace ew {
 	};
 	//Rotation around X axis (pitch) in radians
 	inline ew::Mat4 RotateX(float rad) {
-		const float cosA = cosf(rad);
-		const float sinA = sinf(rad);
+		float sinA, cosA;
+		ew::FastSinCos(rad, &sinA, &cosA);
 		return Mat4(
 			1.0f, 0.0f, 0.0f, 0.0f,
 			0.0f, cosA, -sinA, 0.0f,
@@ -38,8 +39,8 @@ namespace ew {
 	};
 	//Rotation around Y axis (yaw) in radians
 	inline ew::Mat4 RotateY(float rad) {
-		const float cosA = cosf(rad);
-		const float sinA = sinf(rad);
+		float sinA, cosA;
+		ew::FastSinCos(rad, &sinA, &cosA);
 		return Mat4(
 			cosA, 0.0f, sinA, 0.0f,
 			0.0f, 1.0f, 0.0f, 0.0f,
@@ -49,8 +50,8 @@ namespace ew {
 	};
 	//Rotation around Z axis (roll) in radians
 	inline ew::Mat4 RotateZ(float rad) {
-		const float cosA = cosf(rad);
-		const float sinA = sinf(rad);
+		float sinA, cosA;
+		ew::FastSinCos(rad, &sinA, &cosA);
 		return Mat4(
 			cosA, -sinA, 0.0f, 0.0f,
 			sinA, cosA, 0.0f, 0.0f,
@@ -59,7 +60,7 @@ namespace ew {
 		);
 	};
 	//Translate x,y,z
-	inline ew::Mat4 Translate(const ew::Vec3& t) {
+	inline constexpr ew::Mat4 Translate(const ew::Vec3& t) {
 		return Mat4(
 			1.0f, 0.0f, 0.0f, t.x,
 			0.0f, 1.0f, 0.0f, t.y,
@@ -68,11 +69,33 @@ namespace ew {
 		);
 	};
 
-	inline ew::Mat4 LookAt(const ew::Vec3& eyePos, const ew::Vec3& targetPos, const ew::Vec3& up) {
-		ew::Vec3 f = ew::Normalize(eyePos - targetPos);
-		ew::Vec3 r = ew::Normalize(ew::Cross(up, f));
-		ew::Vec3 u = ew::Normalize(ew::Cross(f,r));
-		ew::Mat4 m = ew::Mat4(
+	//Translate(t) * RotateY(r.y) * RotateX(r.x) * RotateZ(r.z) * Scale(s), built in closed form.
+	//sinR and cosR hold the sines and cosines of the Euler angles, so batches can compute them up front.
+	inline constexpr ew::Mat4 TRS(const ew::Vec3& t, const ew::Vec3& sinR, const ew::Vec3& cosR, const ew::Vec3& s) {
+		const float sx = sinR.x, cx = cosR.x;
+		const float sy = sinR.y, cy = cosR.y;
+		const float sz = sinR.z, cz = cosR.z;
+		return ew::Mat4(
+			(cy * cz + sy * sx * sz) * s.x, (sy * sx * cz - cy * sz) * s.y, sy * cx * s.z, t.x,
+			cx * sz * s.x, cx * cz * s.y, -sx * s.z, t.y,
+			(cy * sx * sz - sy * cz) * s.x, (sy * sz + cy * sx * cz) * s.y, cy * cx * s.z, t.z,
+			0.0f, 0.0f, 0.0f, 1.0f
+		);
+	}
+	//Translate(t) * RotateY(r.y) * RotateX(r.x) * RotateZ(r.z) * Scale(s). Euler angles in radians
+	inline ew::Mat4 TRS(const ew::Vec3& t, const ew::Vec3& r, const ew::Vec3& s) {
+		ew::Vec3 sinR, cosR;
+		ew::FastSinCos(r.x, &sinR.x, &cosR.x);
+		ew::FastSinCos(r.y, &sinR.y, &cosR.y);
+		ew::FastSinCos(r.z, &sinR.z, &cosR.z);
+		return TRS(t, sinR, cosR, s);
+	}
+
+	inline constexpr ew::Mat4 LookAt(const ew::Vec3& eyePos, const ew::Vec3& targetPos, const ew::Vec3& up) {
+		const ew::Vec3 f = ew::Normalize(eyePos - targetPos);
+		const ew::Vec3 r = ew::Normalize(ew::Cross(up, f));
+		const ew::Vec3 u = ew::Normalize(ew::Cross(f,r));
+		const ew::Mat4 m = ew::Mat4(
 			r.x, r.y, r.z, -ew::Dot(r, eyePos),
 			u.x, u.y, u.z, -ew::Dot(u, eyePos),
 			f.x, f.y, f.z, -ew::Dot(f, eyePos),
@@ -81,31 +104,27 @@ namespace ew {
 	}
 
 	inline ew::Mat4 Perspective(float fov, float a, float n, float f) {
-		float c = tanf(fov / 2.0f);
-		Mat4 m = Mat4(0);
-		m[0][0] = 1.0f / (c * a); //Scale X
-		m[1][1] = 1.0f / c; //Scale Y
-		m[2][2] = (f + n) / (n-f); //Scale Z
-		m[3][2] = (2 * f * n) / (n-f); //Translate Z
-		m[2][3] = -1.0f; //Perspective divide (puts Z in W component of vector)
-		return m;
+		const float c = tanf(fov / 2.0f);
+		return Mat4(
+			1.0f / (c * a), 0.0f, 0.0f, 0.0f, //Scale X
+			0.0f, 1.0f / c, 0.0f, 0.0f, //Scale Y
+			0.0f, 0.0f, (f + n) / (n - f), (2 * f * n) / (n - f), //Scale Z, Translate Z
+			0.0f, 0.0f, -1.0f, 0.0f //Perspective divide (puts Z in W component of vector)
+		);
 	}
 
-	inline ew::Mat4 Orthographic(float height, float a, float n, float f) {
+	inline constexpr ew::Mat4 Orthographic(float height, float a, float n, float f) {
 		//Symmetrical bounds based on aspect ratio
-		float t = height / 2;
-		float b = -t;
-		float r = (height * a) / 2;
-		float l = -r;
+		const float t = height / 2;
+		const float b = -t;
+		const float r = (height * a) / 2;
+		const float l = -r;
 
-		Mat4 m = Mat4(0);
-		m[0][0] = 2 / (r - l);
-		m[1][1] = 2 / (t - b);
-		m[2][2] = -2 / (f - n);
-		m[3][0] = -(r + l) / (r - l);
-		m[3][1] = -(t + b) / (t - b);
-		m[3][2] = -(f + n) / (f - n);
-		m[3][3] = 1.0f;
-		return m;
+		return Mat4(
+			2 / (r - l), 0.0f, 0.0f, -(r + l) / (r - l),
+			0.0f, 2 / (t - b), 0.0f, -(t + b) / (t - b),
+			0.0f, 0.0f, -2 / (f - n), -(f + n) / (f - n),
+			0.0f, 0.0f, 0.0f, 1.0f
+		);
 	}
 }
@@ -0,0 +1,232 @@
+#include "geometryPool.h"
+#include <iterator>
+#include "external/glad.h"
+
+namespace ew {
+	bool GeometryPool::FreeList::allocate(size_t count, size_t* offset)
+	{
+		if (count == 0) {
+			*offset = 0;
+			return true;
+		}
+		for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+			if (it->second < count) {
+				continue;
+			}
+			*offset = it->first;
+			const size_t remaining = it->second - count;
+			ranges.erase(it);
+			if (remaining > 0) {
+				ranges[*offset + count] = remaining;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void GeometryPool::FreeList::free(size_t offset, size_t count)
+	{
+		if (count == 0) {
+			return;
+		}
+		auto next = ranges.lower_bound(offset);
+		if (next != ranges.end() && offset + count == next->first) {
+			count += next->second;
+			next = ranges.erase(next);
+		}
+		if (next != ranges.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				prev->second += count;
+				return;
+			}
+		}
+		ranges[offset] = count;
+	}
+
+	void GeometryPool::FreeList::grow(size_t newCapacity)
+	{
+		const size_t oldCapacity = capacity;
+		capacity = newCapacity;
+		free(oldCapacity, newCapacity - oldCapacity);
+	}
+
+	GeometryPool::GeometryPool(size_t vertexCapacity, size_t indexCapacity)
+	{
+		glGenVertexArrays(1, &m_vao);
+		glBindVertexArray(m_vao);
+		growBuffer(&m_vbo, GL_ARRAY_BUFFER, 0, vertexCapacity, sizeof(Vertex));
+		growBuffer(&m_ebo, GL_ELEMENT_ARRAY_BUFFER, 0, indexCapacity, sizeof(uint16_t));
+		InstanceBuffer::setupAttributes();
+		glBindVertexArray(0);
+		m_vertices.grow(vertexCapacity);
+		m_indices.grow(indexCapacity);
+	}
+
+	GeometryPool::~GeometryPool()
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+	}
+
+	void GeometryPool::growBuffer(unsigned int* buffer, unsigned int target, size_t oldCapacity, size_t newCapacity, size_t elementSize)
+	{
+		//Expects the pool's vertex array to be bound, so the new buffers are attached to it
+		GLuint grown;
+		glGenBuffers(1, &grown);
+		glBindBuffer(target, grown);
+		glBufferData(target, newCapacity * elementSize, NULL, GL_STATIC_DRAW);
+		if (*buffer != 0) {
+			if (oldCapacity > 0) {
+				glBindBuffer(GL_COPY_READ_BUFFER, *buffer);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, target, 0, 0, oldCapacity * elementSize);
+				glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			}
+			glDeleteBuffers(1, buffer);
+		}
+		*buffer = grown;
+		if (target == GL_ARRAY_BUFFER) {
+			SetVertexAttributes(VertexFormat::FLOAT32);
+		}
+	}
+
+	void GeometryPool::allocate(FreeList* list, unsigned int* buffer, unsigned int target, size_t elementSize, size_t count, size_t* offset)
+	{
+		if (list->allocate(count, offset)) {
+			return;
+		}
+		const size_t oldCapacity = list->capacity;
+		size_t newCapacity = oldCapacity > 0 ? oldCapacity * 2 : count;
+		while (newCapacity < oldCapacity + count) {
+			newCapacity *= 2;
+		}
+		growBuffer(buffer, target, oldCapacity, newCapacity, elementSize);
+		list->grow(newCapacity);
+		list->allocate(count, offset);
+	}
+
+	size_t GeometryPool::add(const MeshData& meshData)
+	{
+		return add(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size());
+	}
+
+	size_t GeometryPool::add(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices)
+	{
+		SubmeshData storage;
+		return add(ToSubmeshView(vertices, numVertices, indices, numIndices, &storage));
+	}
+
+	size_t GeometryPool::add(const SubmeshView& view)
+	{
+		PooledMesh mesh;
+		mesh.used = true;
+		mesh.bounds = view.bounds;
+		mesh.boundingSphere = view.boundingSphere;
+		mesh.submeshes.assign(view.submeshes, view.submeshes + view.numSubmeshes);
+
+		glBindVertexArray(m_vao);
+		allocate(&m_vertices, &m_vbo, GL_ARRAY_BUFFER, sizeof(Vertex), view.numVertices, &mesh.firstVertex);
+		allocate(&m_indices, &m_ebo, GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t), view.numIndices, &mesh.firstIndex);
+		mesh.numVertices = view.numVertices;
+		mesh.numIndices = view.numIndices;
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		if (view.numVertices > 0) {
+			glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vertex) * mesh.firstVertex, sizeof(Vertex) * view.numVertices, view.vertices);
+		}
+		if (view.numIndices > 0) {
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * mesh.firstIndex, sizeof(uint16_t) * view.numIndices, view.indices);
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		for (Submesh& submesh : mesh.submeshes) {
+			submesh.firstIndex += mesh.firstIndex;
+			submesh.baseVertex += mesh.firstVertex;
+		}
+
+		if (!m_freeHandles.empty()) {
+			const size_t handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+			m_meshes[handle] = mesh;
+			return handle;
+		}
+		m_meshes.push_back(mesh);
+		return m_meshes.size() - 1;
+	}
+
+	void GeometryPool::remove(size_t mesh)
+	{
+		PooledMesh& pooled = m_meshes[mesh];
+		if (!pooled.used) {
+			return;
+		}
+		m_vertices.free(pooled.firstVertex, pooled.numVertices);
+		m_indices.free(pooled.firstIndex, pooled.numIndices);
+		pooled = PooledMesh();
+		m_freeHandles.push_back(mesh);
+	}
+
+	DrawList::~DrawList()
+	{
+		m_instanceBuffer.unload();
+		if (m_commandBuffer != 0) {
+			glDeleteBuffers(1, &m_commandBuffer);
+		}
+	}
+
+	void DrawList::clear()
+	{
+		m_commands.clear();
+		m_instances.clear();
+	}
+
+	void DrawList::add(const GeometryPool& pool, size_t mesh, const InstanceData* instances, size_t count)
+	{
+		if (count == 0) {
+			return;
+		}
+		const uint32_t baseInstance = (uint32_t)m_instances.size();
+		m_instances.insert(m_instances.end(), instances, instances + count);
+		for (const Submesh& submesh : pool.getSubmeshes(mesh)) {
+			DrawElementsIndirectCommand command;
+			command.count = (uint32_t)submesh.numIndices;
+			command.instanceCount = (uint32_t)count;
+			command.firstIndex = (uint32_t)submesh.firstIndex;
+			command.baseVertex = (int32_t)submesh.baseVertex;
+			command.baseInstance = baseInstance;
+			m_commands.push_back(command);
+		}
+	}
+
+	void DrawList::add(const GeometryPool& pool, size_t mesh, const ew::Mat4& model, const ew::Vec4& color)
+	{
+		InstanceData instance;
+		instance.model = model;
+		instance.normalMatrix = NormalMatrix(model);
+		instance.color = color;
+		add(pool, mesh, &instance, 1);
+	}
+
+	void DrawList::submit(const GeometryPool& pool)
+	{
+		static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(uint32_t), "DrawElementsIndirectCommand must be 5 packed uints");
+		if (m_commands.empty()) {
+			return;
+		}
+		m_instanceBuffer.update(m_instances.data(), m_instances.size());
+		if (m_commandBuffer == 0) {
+			glGenBuffers(1, &m_commandBuffer);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * m_commands.size(), m_commands.data(), GL_STREAM_DRAW);
+
+		glBindVertexArray(pool.getVertexArray());
+		m_instanceBuffer.bind();
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, NULL, (GLsizei)m_commands.size(), 0);
+		InstanceBuffer::unbind();
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "mesh.h"
+#include "instanceBuffer.h"
+
+namespace ew {
+	//Many meshes packed into one vertex buffer and one 16 bit index buffer behind a single vertex array,
+	//so they can all be drawn by one glMultiDrawElementsIndirect call. Buffers grow by doubling when full.
+	//Vertices are stored as FLOAT32, since quantized formats would need per mesh decode uniforms
+	class GeometryPool {
+	public:
+		GeometryPool(size_t vertexCapacity = 1 << 16, size_t indexCapacity = 3 << 16);
+		~GeometryPool();
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		//Copies a mesh into the pool and returns its handle. Meshes with more than MAX_16BIT_VERTICES vertices
+		//are split into submeshes first
+		size_t add(const MeshData& meshData);
+		size_t add(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices);
+		//Copies submeshes that are already split and 16 bit, e.g. from a mapped cache file, without converting them
+		size_t add(const SubmeshView& view);
+		//Frees the ranges of mesh for later adds. The handle may be reused
+		void remove(size_t mesh);
+
+		//Submeshes with firstIndex and baseVertex relative to the start of the pool buffers
+		inline const std::vector<Submesh>& getSubmeshes(size_t mesh)const { return m_meshes[mesh].submeshes; }
+		inline const AABB& getBounds(size_t mesh)const { return m_meshes[mesh].bounds; }
+		inline const BoundingSphere& getBoundingSphere(size_t mesh)const { return m_meshes[mesh].boundingSphere; }
+		inline unsigned int getVertexArray()const { return m_vao; }
+		inline size_t getVertexCapacity()const { return m_vertices.capacity; }
+		inline size_t getIndexCapacity()const { return m_indices.capacity; }
+
+	private:
+		//First fit allocator over ranges of a buffer, merging neighbors on free
+		struct FreeList {
+			size_t capacity = 0;
+			std::map<size_t, size_t> ranges; //Offset to length of each free range
+			bool allocate(size_t count, size_t* offset);
+			void free(size_t offset, size_t count);
+			void grow(size_t newCapacity);
+		};
+
+		struct PooledMesh {
+			bool used = false;
+			size_t firstVertex = 0;
+			size_t numVertices = 0;
+			size_t firstIndex = 0;
+			size_t numIndices = 0;
+			AABB bounds;
+			BoundingSphere boundingSphere;
+			std::vector<Submesh> submeshes;
+		};
+
+		//Replaces buffer with one holding newCapacity elements of elementSize bytes, keeping the first oldCapacity
+		void growBuffer(unsigned int* buffer, unsigned int target, size_t oldCapacity, size_t newCapacity, size_t elementSize);
+		//Allocates count elements from list, growing buffer if no free range fits
+		void allocate(FreeList* list, unsigned int* buffer, unsigned int target, size_t elementSize, size_t count, size_t* offset);
+
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		unsigned int m_ebo = 0;
+		FreeList m_vertices;
+		FreeList m_indices;
+		std::vector<PooledMesh> m_meshes;
+		std::vector<size_t> m_freeHandles;
+	};
+
+	//Same layout as the command struct glMultiDrawElementsIndirect reads
+	struct DrawElementsIndirectCommand {
+		uint32_t count;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t baseVertex;
+		uint32_t baseInstance;
+	};
+
+	//Collects draws of GeometryPool meshes over a frame and submits them in one glMultiDrawElementsIndirect call.
+	//Each draw's InstanceData is read through the instance attributes, starting at the command's baseInstance,
+	//so shaders written for Mesh::drawInstanced work unchanged
+	class DrawList {
+	public:
+		DrawList() {};
+		~DrawList();
+		DrawList(const DrawList&) = delete;
+		DrawList& operator=(const DrawList&) = delete;
+
+		void clear();
+		//Draws every submesh of mesh once per instance
+		void add(const GeometryPool& pool, size_t mesh, const InstanceData* instances, size_t count);
+		void add(const GeometryPool& pool, size_t mesh, const ew::Mat4& model, const ew::Vec4& color = ew::Vec4(1.0f));
+		//Uploads the commands and per draw data, then draws them. Every mesh added must come from pool
+		void submit(const GeometryPool& pool);
+		inline size_t getNumCommands()const { return m_commands.size(); }
+		inline size_t getNumInstances()const { return m_instances.size(); }
+
+	private:
+		std::vector<DrawElementsIndirectCommand> m_commands;
+		std::vector<InstanceData> m_instances;
+		InstanceBuffer m_instanceBuffer;
+		unsigned int m_commandBuffer = 0;
+	};
+}
@@ -0,0 +1,111 @@
+#include "instanceBuffer.h"
+#include "parallel.h"
+#include "external/glad.h"
+
+namespace ew {
+	static_assert(sizeof(InstanceData) == 29 * sizeof(float), "InstanceData must be tightly packed floats");
+
+	//Smaller than DEFAULT_MIN_CHUNK since each instance builds a model and a normal matrix
+	static const size_t MIN_INSTANCES_PER_THREAD = 4096;
+
+	void InstanceBuffer::update(const InstanceData* instances, size_t count)
+	{
+		if (m_buffer == 0) {
+			glGenBuffers(1, &m_buffer);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		if (count > m_capacity) {
+			m_capacity = count > m_capacity * 2 ? count : m_capacity * 2;
+		}
+		//Orphan the old storage, then fill only the part in use
+		glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * m_capacity, NULL, GL_STREAM_DRAW);
+		if (count > 0) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * count, instances);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_count = count;
+	}
+
+	void InstanceBuffer::update(const std::vector<Transform>& transforms, const ew::Vec4& color)
+	{
+		m_staging.resize(transforms.size());
+		ParallelFor(0, transforms.size(), MIN_INSTANCES_PER_THREAD, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				InstanceData& instance = m_staging[i];
+				instance.model = transforms[i].getModelMatrix();
+				instance.normalMatrix = NormalMatrix(instance.model);
+				instance.color = color;
+			}
+		});
+		update(m_staging.data(), m_staging.size());
+	}
+
+	void InstanceBuffer::update(const std::vector<Transform>& transforms, const std::vector<ew::Vec4>& colors)
+	{
+		m_staging.resize(transforms.size());
+		ParallelFor(0, transforms.size(), MIN_INSTANCES_PER_THREAD, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				InstanceData& instance = m_staging[i];
+				instance.model = transforms[i].getModelMatrix();
+				instance.normalMatrix = NormalMatrix(instance.model);
+				instance.color = i < colors.size() ? colors[i] : ew::Vec4(1.0f);
+			}
+		});
+		update(m_staging.data(), m_staging.size());
+	}
+
+	void InstanceBuffer::update(const ew::Mat4* models, size_t count, const ew::Vec4& color)
+	{
+		m_staging.resize(count);
+		ParallelFor(0, count, MIN_INSTANCES_PER_THREAD, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				InstanceData& instance = m_staging[i];
+				instance.model = models[i];
+				instance.normalMatrix = NormalMatrix(models[i]);
+				instance.color = color;
+			}
+		});
+		update(m_staging.data(), m_staging.size());
+	}
+
+	void InstanceBuffer::unload()
+	{
+		if (m_buffer != 0) {
+			glDeleteBuffers(1, &m_buffer);
+		}
+		m_buffer = 0;
+		m_count = m_capacity = 0;
+	}
+
+	void InstanceBuffer::setupAttributes()
+	{
+		//Matrices take one location per column
+		for (GLuint i = 0; i < 4; i++) {
+			glVertexAttribFormat(MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, (GLuint)(offsetof(InstanceData, model) + sizeof(ew::Vec4) * i));
+			glVertexAttribBinding(MODEL_LOCATION + i, BINDING);
+		}
+		for (GLuint i = 0; i < 3; i++) {
+			glVertexAttribFormat(NORMAL_MATRIX_LOCATION + i, 3, GL_FLOAT, GL_FALSE, (GLuint)(offsetof(InstanceData, normalMatrix) + sizeof(ew::Vec3) * i));
+			glVertexAttribBinding(NORMAL_MATRIX_LOCATION + i, BINDING);
+		}
+		glVertexAttribFormat(COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, (GLuint)offsetof(InstanceData, color));
+		glVertexAttribBinding(COLOR_LOCATION, BINDING);
+		glVertexBindingDivisor(BINDING, 1);
+	}
+
+	void InstanceBuffer::bind(size_t first) const
+	{
+		glBindVertexBuffer(BINDING, m_buffer, (GLintptr)(sizeof(InstanceData) * first), sizeof(InstanceData));
+		for (GLuint i = MODEL_LOCATION; i <= COLOR_LOCATION; i++) {
+			glEnableVertexAttribArray(i);
+		}
+	}
+
+	void InstanceBuffer::unbind()
+	{
+		//Left enabled, the attributes would make non instanced draws with this vertex array read an unbound buffer
+		for (GLuint i = MODEL_LOCATION; i <= COLOR_LOCATION; i++) {
+			glDisableVertexAttribArray(i);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "ewMath/ewMath.h"
+#include "transform.h"
+
+namespace ew {
+	//Per instance vertex attributes read by instanced shaders:
+	//	layout(location = 3) in mat4 _InstanceModel; //Locations 3-6
+	//	layout(location = 7) in mat3 _InstanceNormalMatrix; //Locations 7-9
+	//	layout(location = 10) in vec4 _InstanceColor;
+	struct InstanceData {
+		ew::Mat4 model;
+		ew::Mat3 normalMatrix;
+		ew::Vec4 color;
+	};
+
+	//GPU buffer of InstanceData for Mesh::drawInstanced. Grows to fit and is orphaned on every update,
+	//so it can be rewritten each frame without waiting on draws still reading the previous contents
+	class InstanceBuffer {
+	public:
+		static const unsigned int MODEL_LOCATION = 3;
+		static const unsigned int NORMAL_MATRIX_LOCATION = 7;
+		static const unsigned int COLOR_LOCATION = 10;
+		//Vertex buffer binding point instance attributes are read from, clear of the per vertex attributes
+		static const unsigned int BINDING = 15;
+
+		InstanceBuffer() {};
+		void update(const InstanceData* instances, size_t count);
+		//Builds model and normal matrices from transforms in parallel
+		void update(const std::vector<Transform>& transforms, const ew::Vec4& color = ew::Vec4(1.0f));
+		void update(const std::vector<Transform>& transforms, const std::vector<ew::Vec4>& colors);
+		//For model matrices built elsewhere
+		void update(const ew::Mat4* models, size_t count, const ew::Vec4& color = ew::Vec4(1.0f));
+		void unload();
+		inline size_t getCount()const { return m_count; }
+		inline unsigned int getBuffer()const { return m_buffer; }
+
+		//Describes the instance attributes on the bound vertex array, reading from BINDING. Called once per Mesh
+		static void setupAttributes();
+		//Binds this buffer starting at instance first and enables the instance attributes on the bound vertex array
+		void bind(size_t first = 0)const;
+		static void unbind();
+
+	private:
+		unsigned int m_buffer = 0;
+		size_t m_count = 0;
+		size_t m_capacity = 0;
+		std::vector<InstanceData> m_staging;
+	};
+}
@@ -0,0 +1,48 @@
+#include "lod.h"
+#include <math.h>
+
+namespace ew {
+	float ProjectedPixels(const Camera& camera, const BoundingSphere& worldSphere, float worldLength, float screenHeight)
+	{
+		if (camera.orthographic) {
+			return worldLength * screenHeight / camera.orthoHeight;
+		}
+		const float distance = fmaxf(Magnitude(worldSphere.center - camera.position) - worldSphere.radius, camera.nearPlane);
+		return worldLength * screenHeight / (2.0f * distance * tanf(ew::Radians(camera.fov) * 0.5f));
+	}
+
+	void LodMesh::load(const MeshData& meshData, const LodSettings& settings, VertexFormat vertexFormat)
+	{
+		load(generateLodChain(meshData, settings), vertexFormat);
+	}
+
+	void LodMesh::load(const LodChain& chain, VertexFormat vertexFormat)
+	{
+		//Meshes own no GL state on destruction, so reuse existing buffers where there are some
+		//and delete those of levels the new chain no longer has
+		for (size_t i = chain.levels.size(); i < m_levels.size(); i++) {
+			m_levels[i].unload();
+		}
+		m_levels.resize(chain.levels.size());
+		for (size_t i = 0; i < chain.levels.size(); i++) {
+			m_levels[i].load(chain.levels[i], vertexFormat);
+		}
+		m_errors = chain.errors;
+	}
+
+	size_t LodMesh::selectLevel(const Camera& camera, const Mat4& model, float screenHeight, float maxPixelError) const
+	{
+		if (m_levels.empty()) {
+			return 0;
+		}
+		const BoundingSphere& modelSphere = getBoundingSphere();
+		const BoundingSphere worldSphere = TransformSphere(modelSphere, model);
+		//Errors scale with the model matrix's largest axis scale, the same factor as the radius
+		const float scale = modelSphere.radius > 0.0f ? worldSphere.radius / modelSphere.radius : 1.0f;
+		size_t level = 0;
+		while (level + 1 < m_levels.size() && ProjectedPixels(camera, worldSphere, m_errors[level + 1] * scale, screenHeight) <= maxPixelError) {
+			level++;
+		}
+		return level;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include "mesh.h"
+#include "camera.h"
+#include "simplify.h"
+
+namespace ew {
+	//Height in pixels a world space length spans at the nearest point of sphere, for a viewport screenHeight pixels tall
+	float ProjectedPixels(const Camera& camera, const BoundingSphere& worldSphere, float worldLength, float screenHeight);
+
+	//Mesh with coarser levels of detail uploaded alongside it. Each frame, draw the level selectLevel picks
+	class LodMesh {
+	public:
+		LodMesh() {};
+		//Generates the chain from meshData and uploads every level
+		void load(const MeshData& meshData, const LodSettings& settings = LodSettings(), VertexFormat vertexFormat = VertexFormat::FLOAT32);
+		//Uploads a chain generated earlier, e.g. offline
+		void load(const LodChain& chain, VertexFormat vertexFormat = VertexFormat::FLOAT32);
+		//Coarsest level whose error estimate projects to at most maxPixelError pixels with this model matrix.
+		//The estimate can be exceeded in places, so a level may be off by somewhat more than maxPixelError
+		size_t selectLevel(const Camera& camera, const Mat4& model, float screenHeight, float maxPixelError = 1.0f)const;
+		inline size_t getNumLevels()const { return m_levels.size(); }
+		inline const Mesh& getLevel(size_t level)const { return m_levels[level]; }
+		inline float getError(size_t level)const { return m_errors[level]; }
+		//Full detail bounds, which contain every level
+		inline const BoundingSphere& getBoundingSphere()const { return m_levels[0].getBoundingSphere(); }
+
+	private:
+		std::vector<Mesh> m_levels;
+		std::vector<float> m_errors;
+	};
+}
@@ -3,66 +3,472 @@
 */
 
 #include "mesh.h"
+#include <stdio.h>
+#include <string.h>
+#include "instanceBuffer.h"
 #include "ewMath/ewMath.h"
 #include "external/glad.h"
 
 namespace ew {
-	Mesh::Mesh(const MeshData& meshData)
+	MeshData AllocateMeshData(const MeshSize& size)
 	{
-		load(meshData);
+		MeshData meshData;
+		meshData.vertices.resize(size.numVertices);
+		meshData.indices.resize(size.numIndices);
+		return meshData;
 	}
-	void Mesh::load(const MeshData& meshData)
+	AABB ComputeBounds(const MeshData& meshData)
 	{
-		if (!m_initialized) {
-			glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
+		return ComputeBounds(meshData.vertices.data(), meshData.vertices.size());
+	}
+	AABB ComputeBounds(const Vertex* vertices, size_t numVertices)
+	{
+		AABB bounds;
+		if (numVertices == 0) {
+			return bounds;
+		}
+		bounds.min = bounds.max = vertices[0].pos;
+		for (size_t i = 0; i < numVertices; i++) {
+			const Vertex& v = vertices[i];
+			bounds.min = ew::Vec3(fminf(bounds.min.x, v.pos.x), fminf(bounds.min.y, v.pos.y), fminf(bounds.min.z, v.pos.z));
+			bounds.max = ew::Vec3(fmaxf(bounds.max.x, v.pos.x), fmaxf(bounds.max.y, v.pos.y), fmaxf(bounds.max.z, v.pos.z));
+		}
+		return bounds;
+	}
+	BoundingSphere ComputeBoundingSphere(const MeshData& meshData)
+	{
+		return ComputeBoundingSphere(meshData.vertices.data(), meshData.vertices.size());
+	}
+	BoundingSphere ComputeBoundingSphere(const Vertex* vertices, size_t numVertices)
+	{
+		BoundingSphere sphere;
+		sphere.center = ComputeBounds(vertices, numVertices).center();
+		float maxDistSq = 0.0f;
+		for (size_t i = 0; i < numVertices; i++) {
+			const ew::Vec3 d = vertices[i].pos - sphere.center;
+			maxDistSq = fmaxf(maxDistSq, ew::Dot(d, d));
+		}
+		sphere.radius = sqrtf(maxDistSq);
+		return sphere;
+	}
+	SubmeshData SplitSubmeshes(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, size_t maxVertices)
+	{
+		const unsigned int UNASSIGNED = ~0u;
+		//Below 3, a triangle with 3 new vertices would never fit and the loop below would not advance
+		if (maxVertices < 3) {
+			maxVertices = 3;
+		}
+		if (maxVertices > MAX_16BIT_VERTICES) {
+			maxVertices = MAX_16BIT_VERTICES;
+		}
+		const size_t numTriangles = numIndices / 3;
+		SubmeshData data;
+		data.indices.resize(numTriangles * 3);
+		//Index of each source vertex within the current submesh
+		std::vector<unsigned int> localIndex(numVertices, UNASSIGNED);
+		std::vector<unsigned int> sourceVertices;
+		size_t t = 0;
+		while (t < numTriangles) {
+			Submesh submesh;
+			submesh.firstIndex = t * 3;
+			submesh.baseVertex = data.vertices.size();
+			sourceVertices.clear();
+			for (; t < numTriangles; t++) {
+				const unsigned int* tri = &indices[t * 3];
+				const size_t newVertices = (localIndex[tri[0]] == UNASSIGNED)
+					+ (localIndex[tri[1]] == UNASSIGNED && tri[1] != tri[0])
+					+ (localIndex[tri[2]] == UNASSIGNED && tri[2] != tri[0] && tri[2] != tri[1]);
+				if (sourceVertices.size() + newVertices > maxVertices) {
+					break;
+				}
+				for (int k = 0; k < 3; k++) {
+					const unsigned int v = tri[k];
+					if (localIndex[v] == UNASSIGNED) {
+						localIndex[v] = (unsigned int)sourceVertices.size();
+						sourceVertices.push_back(v);
+						data.vertices.push_back(vertices[v]);
+					}
+					data.indices[t * 3 + k] = (uint16_t)localIndex[v];
+				}
+			}
+			for (unsigned int v : sourceVertices) {
+				localIndex[v] = UNASSIGNED;
+			}
+			submesh.numIndices = t * 3 - submesh.firstIndex;
+			submesh.numVertices = sourceVertices.size();
+			submesh.bounds = ComputeBounds(&data.vertices[submesh.baseVertex], submesh.numVertices);
+			submesh.boundingSphere = ComputeBoundingSphere(&data.vertices[submesh.baseVertex], submesh.numVertices);
+			data.submeshes.push_back(submesh);
+		}
+		return data;
+	}
 
-			glGenBuffers(1, &m_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	SubmeshView ToSubmeshView(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, SubmeshData* storage)
+	{
+		SubmeshView view;
+		view.bounds = ComputeBounds(vertices, numVertices);
+		view.boundingSphere = ComputeBoundingSphere(vertices, numVertices);
+		view.vertices = vertices;
+		view.numVertices = numVertices;
+		if (numIndices == 0) {
+			return view;
+		}
+		if (numVertices <= MAX_16BIT_VERTICES) {
+			storage->indices.resize(numIndices);
+			for (size_t i = 0; i < numIndices; i++) {
+				storage->indices[i] = (uint16_t)indices[i];
+			}
+			Submesh submesh;
+			submesh.firstIndex = 0;
+			submesh.numIndices = numIndices;
+			submesh.baseVertex = 0;
+			submesh.numVertices = numVertices;
+			submesh.bounds = view.bounds;
+			submesh.boundingSphere = view.boundingSphere;
+			storage->submeshes.assign(1, submesh);
+			storage->vertices.clear();
+		}
+		else {
+			*storage = SplitSubmeshes(vertices, numVertices, indices, numIndices);
+			view.vertices = storage->vertices.data();
+			view.numVertices = storage->vertices.size();
+		}
+		view.indices = storage->indices.data();
+		view.numIndices = storage->indices.size();
+		view.submeshes = storage->submeshes.data();
+		view.numSubmeshes = storage->submeshes.size();
+		return view;
+	}
 
-			glGenBuffers(1, &m_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-			//Position attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
-			glEnableVertexAttribArray(0);
+	namespace {
+		struct AttributeLayout {
+			GLint size;
+			GLenum type;
+			GLboolean normalized;
+			size_t offset;
+		};
+		//Position, normal and uv attributes of each VertexFormat
+		struct VertexLayout {
+			GLsizei stride;
+			AttributeLayout attributes[3];
+		};
+		static const VertexLayout VERTEX_LAYOUTS[] = {
+			{ sizeof(Vertex), {
+				{ 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, pos) },
+				{ 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal) },
+				{ 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, uv) } } },
+			{ sizeof(VertexHalf), {
+				{ 3, GL_HALF_FLOAT, GL_FALSE, offsetof(VertexHalf, pos) },
+				{ 2, GL_SHORT, GL_TRUE, offsetof(VertexHalf, normal) },
+				{ 2, GL_HALF_FLOAT, GL_FALSE, offsetof(VertexHalf, uv) } } },
+			{ sizeof(VertexSnorm16), {
+				{ 3, GL_SHORT, GL_TRUE, offsetof(VertexSnorm16, pos) },
+				{ 2, GL_SHORT, GL_TRUE, offsetof(VertexSnorm16, normal) },
+				{ 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(VertexSnorm16, uv) } } },
+			{ sizeof(VertexCompact), {
+				{ 3, GL_SHORT, GL_TRUE, offsetof(VertexCompact, pos) },
+				{ 2, GL_BYTE, GL_TRUE, offsetof(VertexCompact, normal) },
+				{ 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(VertexCompact, uv) } } },
+		};
+
+		//Writes numVertices vertices to out in the layout of format
+		void writeVertices(VertexFormat format, const Vertex* vertices, size_t numVertices, const VertexQuantization& quantization, void* out) {
+			if (format == VertexFormat::FLOAT32) {
+				memcpy(out, vertices, sizeof(Vertex) * numVertices);
+			}
+			else {
+				EncodeVertices(format, vertices, numVertices, quantization, out);
+			}
+		}
 
-			//Normal attribute
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
-			glEnableVertexAttribArray(1);
+		//Grows capacity to hold required elements, at least doubling it so repeated growth stays cheap. Returns true if it grew
+		bool growCapacity(size_t* capacity, size_t required) {
+			if (required <= *capacity) {
+				return false;
+			}
+			*capacity = required > *capacity * 2 ? required : *capacity * 2;
+			return true;
+		}
+
+		//Blocks until the draws fenced by sync finish, then deletes it
+		void waitForFence(void** fence) {
+			if (*fence == nullptr) {
+				return;
+			}
+			const GLsync sync = (GLsync)*fence;
+			while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+			}
+			glDeleteSync(sync);
+			*fence = nullptr;
+		}
+	}
 
-			//UV attribute
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
-			glEnableVertexAttribArray(2);
+	void SetVertexAttributes(VertexFormat format)
+	{
+		const VertexLayout& layout = VERTEX_LAYOUTS[(int)format];
+		for (GLuint i = 0; i < 3; i++) {
+			const AttributeLayout& attribute = layout.attributes[i];
+			glVertexAttribPointer(i, attribute.size, attribute.type, attribute.normalized, layout.stride, (const void*)attribute.offset);
+			glEnableVertexAttribArray(i);
+		}
+	}
 
+	Mesh::Mesh(const MeshData& meshData, VertexFormat vertexFormat, MeshUsage usage)
+	{
+		load(meshData, vertexFormat, usage);
+	}
+	void Mesh::load(const MeshData& meshData, VertexFormat vertexFormat, MeshUsage usage)
+	{
+		load(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), vertexFormat, usage);
+	}
+	void Mesh::load(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, VertexFormat vertexFormat, MeshUsage usage)
+	{
+		//16 bit indices halve index bandwidth. Meshes too large for them are drawn as several submeshes
+		SubmeshData storage;
+		load(ToSubmeshView(vertices, numVertices, indices, numIndices, &storage), vertexFormat, usage);
+	}
+	void Mesh::load(const SubmeshView& view, VertexFormat vertexFormat, MeshUsage usage)
+	{
+		if (!m_initialized) {
+			glGenVertexArrays(1, &m_vao);
+			createBuffers();
 			m_initialized = true;
+			glBindVertexArray(m_vao);
+			InstanceBuffer::setupAttributes();
+		}
+		else if (usage != m_usage || vertexFormat != m_vertexFormat) {
+			//Capacities are counted in vertices of the old format, and stream buffers can't be resized in place
+			deleteBuffers();
+			createBuffers();
 		}
 
 		glBindVertexArray(m_vao);
-		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 
-		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
-		}
-		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+		m_bounds = view.bounds;
+		m_boundingSphere = view.boundingSphere;
+		m_submeshes.assign(view.submeshes, view.submeshes + view.numSubmeshes);
+
+		m_vertexFormat = vertexFormat;
+		m_usage = usage;
+		m_quantization = ComputeVertexQuantization(vertexFormat, view.vertices, view.numVertices);
+		switch (usage) {
+		case MeshUsage::STATIC:
+			uploadStatic(view.vertices, view.numVertices, view.indices, view.numIndices);
+			break;
+		case MeshUsage::DYNAMIC:
+			uploadDynamic(view.vertices, view.numVertices, view.indices, view.numIndices);
+			break;
+		case MeshUsage::STREAM:
+			uploadStream(view.vertices, view.numVertices, view.indices, view.numIndices);
+			break;
 		}
-		m_numVertices = meshData.vertices.size();
-		m_numIndices = meshData.indices.size();
+		m_numVertices = view.numVertices;
+		m_numIndices = view.numIndices;
+
+		//Set on every load since the format or buffer may change
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		SetVertexAttributes(vertexFormat);
 
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
+	void Mesh::createBuffers()
+	{
+		glGenBuffers(1, &m_vbo);
+		glGenBuffers(1, &m_ebo);
+	}
+	void Mesh::deleteBuffers()
+	{
+		//Deleting a buffer also unmaps it
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+		for (int i = 0; i < STREAM_REGIONS; i++) {
+			if (m_fences[i] != nullptr) {
+				glDeleteSync((GLsync)m_fences[i]);
+				m_fences[i] = nullptr;
+			}
+		}
+		m_vbo = m_ebo = 0;
+		m_vertexMap = m_indexMap = nullptr;
+		m_vertexCapacity = m_indexCapacity = 0;
+		m_vertexOffset = m_indexOffset = 0;
+		m_region = 0;
+	}
+	void Mesh::uploadStatic(const Vertex* vertices, size_t numVertices, const uint16_t* indices, size_t numIndices)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		if (numVertices > 0) {
+			if (m_vertexFormat == VertexFormat::FLOAT32) {
+				glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * numVertices, vertices, GL_STATIC_DRAW);
+			}
+			else {
+				std::vector<unsigned char> encoded(numVertices * GetVertexSize(m_vertexFormat));
+				EncodeVertices(m_vertexFormat, vertices, numVertices, m_quantization, encoded.data());
+				glBufferData(GL_ARRAY_BUFFER, encoded.size(), encoded.data(), GL_STATIC_DRAW);
+			}
+		}
+		if (numIndices > 0) {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * numIndices, indices, GL_STATIC_DRAW);
+		}
+		m_vertexCapacity = numVertices;
+		m_indexCapacity = numIndices;
+	}
+	void Mesh::uploadDynamic(const Vertex* vertices, size_t numVertices, const uint16_t* indices, size_t numIndices)
+	{
+		const size_t stride = GetVertexSize(m_vertexFormat);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		if (growCapacity(&m_vertexCapacity, numVertices)) {
+			glBufferData(GL_ARRAY_BUFFER, stride * m_vertexCapacity, NULL, GL_DYNAMIC_DRAW);
+		}
+		if (growCapacity(&m_indexCapacity, numIndices)) {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * m_indexCapacity, NULL, GL_DYNAMIC_DRAW);
+		}
+		//Invalidating lets the driver hand back fresh memory instead of waiting on draws that read the old contents
+		if (numVertices > 0) {
+			void* dst = glMapBufferRange(GL_ARRAY_BUFFER, 0, stride * numVertices, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			writeVertices(m_vertexFormat, vertices, numVertices, m_quantization, dst);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		if (numIndices > 0) {
+			void* dst = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uint16_t) * numIndices, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			memcpy(dst, indices, sizeof(uint16_t) * numIndices);
+			glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+		}
+	}
+	void Mesh::uploadStream(const Vertex* vertices, size_t numVertices, const uint16_t* indices, size_t numIndices)
+	{
+		const size_t stride = GetVertexSize(m_vertexFormat);
+		if (numVertices > m_vertexCapacity || numIndices > m_indexCapacity || m_vertexMap == nullptr) {
+			//Storage is immutable, so growing means new buffers
+			size_t vertexCapacity = m_vertexCapacity;
+			size_t indexCapacity = m_indexCapacity;
+			growCapacity(&vertexCapacity, numVertices > 0 ? numVertices : 1);
+			growCapacity(&indexCapacity, numIndices > 0 ? numIndices : 1);
+			deleteBuffers();
+			createBuffers();
+			m_vertexCapacity = vertexCapacity;
+			m_indexCapacity = indexCapacity;
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+			glBufferStorage(GL_ARRAY_BUFFER, stride * m_vertexCapacity * STREAM_REGIONS, NULL, flags);
+			m_vertexMap = glMapBufferRange(GL_ARRAY_BUFFER, 0, stride * m_vertexCapacity * STREAM_REGIONS, flags);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+			glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * m_indexCapacity * STREAM_REGIONS, NULL, flags);
+			m_indexMap = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uint16_t) * m_indexCapacity * STREAM_REGIONS, flags);
+			if (m_vertexMap == nullptr || m_indexMap == nullptr) {
+				printf("Failed to map stream buffers\n");
+				return;
+			}
+		}
+		else {
+			//Fence the draws made since the last load, then reuse the oldest region once its draws are done
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+			m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_region = (m_region + 1) % STREAM_REGIONS;
+			waitForFence(&m_fences[m_region]);
+		}
+		m_vertexOffset = m_region * m_vertexCapacity;
+		m_indexOffset = m_region * m_indexCapacity;
+		writeVertices(m_vertexFormat, vertices, numVertices, m_quantization, (unsigned char*)m_vertexMap + stride * m_vertexOffset);
+		if (numIndices > 0) {
+			memcpy((uint16_t*)m_indexMap + m_indexOffset, indices, sizeof(uint16_t) * numIndices);
+		}
+	}
+	void Mesh::updateVertices(size_t first, const Vertex* vertices, size_t count)
+	{
+		if (m_usage == MeshUsage::STREAM || m_submeshes.size() > 1) {
+			printf("updateVertices needs a STATIC or DYNAMIC mesh with a single submesh\n");
+			return;
+		}
+		if (first + count > (size_t)m_numVertices) {
+			printf("updateVertices range %zu-%zu is past the mesh's %d vertices\n", first, first + count, m_numVertices);
+			return;
+		}
+		if (count == 0) {
+			return;
+		}
+		const size_t stride = GetVertexSize(m_vertexFormat);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		if (m_vertexFormat == VertexFormat::FLOAT32) {
+			glBufferSubData(GL_ARRAY_BUFFER, stride * first, stride * count, vertices);
+		}
+		else {
+			void* dst = glMapBufferRange(GL_ARRAY_BUFFER, stride * first, stride * count, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+			writeVertices(m_vertexFormat, vertices, count, m_quantization, dst);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		//Bounds only grow, since the vertices replaced are gone
+		const AABB updated = ComputeBounds(vertices, count);
+		m_bounds.min = ew::Vec3(fminf(m_bounds.min.x, updated.min.x), fminf(m_bounds.min.y, updated.min.y), fminf(m_bounds.min.z, updated.min.z));
+		m_bounds.max = ew::Vec3(fmaxf(m_bounds.max.x, updated.max.x), fmaxf(m_bounds.max.y, updated.max.y), fmaxf(m_bounds.max.z, updated.max.z));
+		for (size_t i = 0; i < count; i++) {
+			m_boundingSphere.radius = fmaxf(m_boundingSphere.radius, ew::Magnitude(vertices[i].pos - m_boundingSphere.center));
+		}
+		//Meshes loaded without indices have no submesh
+		if (!m_submeshes.empty()) {
+			m_submeshes[0].bounds = m_bounds;
+			m_submeshes[0].boundingSphere = m_boundingSphere;
+		}
+	}
+	void Mesh::unload()
+	{
+		if (!m_initialized) {
+			return;
+		}
+		glDeleteVertexArrays(1, &m_vao);
+		deleteBuffers();
+		m_vao = 0;
+		m_numVertices = m_numIndices = 0;
+		m_submeshes.clear();
+		m_initialized = false;
+	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
 		glBindVertexArray(m_vao);
 		if (drawMode == DrawMode::TRIANGLES) {
-			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
+			for (const Submesh& submesh : m_submeshes) {
+				glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)submesh.numIndices, GL_UNSIGNED_SHORT, (const void*)((submesh.firstIndex + m_indexOffset) * sizeof(uint16_t)), (GLint)(submesh.baseVertex + m_vertexOffset));
+			}
 		}
 		else {
-			glDrawArrays(GL_POINTS, 0, m_numVertices);
+			glDrawArrays(GL_POINTS, (GLint)m_vertexOffset, m_numVertices);
 		}
 		
 	}
-}
\ No newline at end of file
+	void Mesh::drawSubmesh(size_t index) const
+	{
+		const Submesh& submesh = m_submeshes[index];
+		glBindVertexArray(m_vao);
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)submesh.numIndices, GL_UNSIGNED_SHORT, (const void*)((submesh.firstIndex + m_indexOffset) * sizeof(uint16_t)), (GLint)(submesh.baseVertex + m_vertexOffset));
+	}
+	void Mesh::drawRange(size_t firstIndex, size_t numIndices) const
+	{
+		if (m_submeshes.empty()) {
+			return;
+		}
+		const Submesh& submesh = m_submeshes[0];
+		glBindVertexArray(m_vao);
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)numIndices, GL_UNSIGNED_SHORT, (const void*)((submesh.firstIndex + firstIndex + m_indexOffset) * sizeof(uint16_t)), (GLint)(submesh.baseVertex + m_vertexOffset));
+	}
+	void Mesh::drawInstanced(size_t count) const
+	{
+		glBindVertexArray(m_vao);
+		for (const Submesh& submesh : m_submeshes) {
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)submesh.numIndices, GL_UNSIGNED_SHORT, (const void*)((submesh.firstIndex + m_indexOffset) * sizeof(uint16_t)), (GLsizei)count, (GLint)(submesh.baseVertex + m_vertexOffset));
+		}
+	}
+	void Mesh::drawInstanced(const InstanceBuffer& instances, size_t count, size_t first) const
+	{
+		glBindVertexArray(m_vao);
+		instances.bind(first);
+		for (const Submesh& submesh : m_submeshes) {
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)submesh.numIndices, GL_UNSIGNED_SHORT, (const void*)((submesh.firstIndex + m_indexOffset) * sizeof(uint16_t)), (GLsizei)count, (GLint)(submesh.baseVertex + m_vertexOffset));
+		}
+		InstanceBuffer::unbind();
+	}
+}
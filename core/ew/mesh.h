@@ -4,6 +4,9 @@
 
 #pragma once
 #include "ewMath/ewMath.h"
+#include "ewMath/bounds.h"
+#include "ewMath/packet.h"
+#include "vertexFormat.h"
 
 namespace ew {
 	struct Vertex {
@@ -17,6 +20,127 @@ namespace ew {
 		std::vector<unsigned int> indices;
 	};
 
+	//Exact number of vertices and indices a generator writes
+	struct MeshSize {
+		size_t numVertices;
+		size_t numIndices;
+	};
+
+	//MeshData with vertices and indices resized to hold size exactly
+	MeshData AllocateMeshData(const MeshSize& size);
+
+	//Packet loads and stores of V::WIDTH consecutive vertex positions or normals starting at first,
+	//e.g. ew::LoadPositions<ew::Vec3x8>(meshData.vertices, i)
+	template <typename V>
+	inline V LoadPositions(const std::vector<Vertex>& vertices, size_t first) {
+		return V::Gather(&vertices[first].pos, sizeof(Vertex));
+	}
+	template <typename V>
+	inline V LoadNormals(const std::vector<Vertex>& vertices, size_t first) {
+		return V::Gather(&vertices[first].normal, sizeof(Vertex));
+	}
+	template <typename V>
+	inline void StorePositions(std::vector<Vertex>& vertices, size_t first, const V& positions) {
+		positions.scatter(&vertices[first].pos, sizeof(Vertex));
+	}
+	template <typename V>
+	inline void StoreNormals(std::vector<Vertex>& vertices, size_t first, const V& normals) {
+		normals.scatter(&vertices[first].normal, sizeof(Vertex));
+	}
+
+	//Writes count consecutive vertices, at most the packet width, from packets of positions, normals and uvs.
+	//Components are transposed in registers so each vertex is written with full width stores
+	inline void StoreVertices(Vertex* out, size_t count, const Vec3x4& pos, const Vec3x4& normal, const Float4& u, const Float4& v) {
+		static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must be 8 packed floats");
+		Float4 first[4] = { pos.x, pos.y, pos.z, normal.x };
+		Float4 second[4] = { normal.y, normal.z, u, v };
+		Transpose(first[0], first[1], first[2], first[3]);
+		Transpose(second[0], second[1], second[2], second[3]);
+		Vertex tmp[4];
+		float* dst = reinterpret_cast<float*>(count >= 4 ? out : tmp);
+		for (int i = 0; i < 4; i++) {
+			first[i].store(dst + i * 8);
+			second[i].store(dst + i * 8 + 4);
+		}
+		if (count < 4) {
+			memcpy(out, tmp, count * sizeof(Vertex));
+		}
+	}
+	inline void StoreVertices(Vertex* out, size_t count, const Vec3x8& pos, const Vec3x8& normal, const Float8& u, const Float8& v) {
+		static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must be 8 packed floats");
+		Float8 rows[8] = { pos.x, pos.y, pos.z, normal.x, normal.y, normal.z, u, v };
+		Transpose(rows);
+		Vertex tmp[8];
+		float* dst = reinterpret_cast<float*>(count >= 8 ? out : tmp);
+		for (int i = 0; i < 8; i++) {
+			rows[i].store(dst + i * 8);
+		}
+		if (count < 8) {
+			memcpy(out, tmp, count * sizeof(Vertex));
+		}
+	}
+
+	//Bounds of all vertices in meshData, in model space
+	AABB ComputeBounds(const MeshData& meshData);
+	AABB ComputeBounds(const Vertex* vertices, size_t numVertices);
+	//Sphere centered on the AABB center enclosing all vertices, in model space
+	BoundingSphere ComputeBoundingSphere(const MeshData& meshData);
+	BoundingSphere ComputeBoundingSphere(const Vertex* vertices, size_t numVertices);
+
+	//Meshes with more vertices than this are split into submeshes, so every index fits in 16 bits.
+	//0xFFFF is left unused since it is the fixed primitive restart index
+	const size_t MAX_16BIT_VERTICES = 0xFFFF;
+
+	//Run of triangles drawn with its own base vertex
+	struct Submesh {
+		size_t firstIndex;
+		size_t numIndices;
+		size_t baseVertex;
+		size_t numVertices;
+		AABB bounds;
+		BoundingSphere boundingSphere;
+	};
+
+	struct SubmeshData {
+		std::vector<Submesh> submeshes;
+		std::vector<Vertex> vertices; //Vertices of each submesh in turn, starting at its baseVertex
+		std::vector<uint16_t> indices; //Relative to the submesh's baseVertex
+	};
+
+	//Splits a triangle list into consecutive runs of triangles that each reference at most maxVertices vertices.
+	//Triangle order is kept. Vertices shared by two submeshes are duplicated. maxVertices is clamped to [3, MAX_16BIT_VERTICES]
+	SubmeshData SplitSubmeshes(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, size_t maxVertices = MAX_16BIT_VERTICES);
+
+	//Submeshes ready to upload, in memory owned by someone else, e.g. a SubmeshData or a mapped cache file
+	struct SubmeshView {
+		const Vertex* vertices = nullptr;
+		size_t numVertices = 0;
+		const uint16_t* indices = nullptr; //Relative to each submesh's baseVertex
+		size_t numIndices = 0;
+		const Submesh* submeshes = nullptr;
+		size_t numSubmeshes = 0;
+		AABB bounds;
+		BoundingSphere boundingSphere;
+	};
+
+	//Converts a triangle list to 16 bit indices in storage, splitting it first if it has more than MAX_16BIT_VERTICES vertices.
+	//Unsplit meshes keep pointing at vertices. A mesh without indices gets no submeshes
+	SubmeshView ToSubmeshView(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, SubmeshData* storage);
+
+	//Points attributes 0-2 of the bound vertex array at the bound GL_ARRAY_BUFFER, laid out as format
+	void SetVertexAttributes(VertexFormat format);
+
+	class InstanceBuffer;
+
+	//How often a mesh is reloaded, which decides how load() uploads it
+	enum class MeshUsage {
+		STATIC = 0, //Loaded once. Buffers are allocated to fit exactly
+		DYNAMIC = 1, //Reloaded now and then, e.g. from a UI slider. Buffers grow by doubling and are rewritten in place
+		STREAM = 2 //Reloaded every frame. Buffers hold STREAM_REGIONS copies, each rewritten once the GPU is done reading it
+	};
+	//Copies of a streamed mesh, so the CPU writes one while the GPU still draws up to two older ones
+	const int STREAM_REGIONS = 3;
+
 	enum class DrawMode {
 		TRIANGLES = 0,
 		POINTS = 1
@@ -25,11 +149,41 @@ namespace ew {
 	class Mesh {
 	public:
 		Mesh() {};
-		Mesh(const MeshData& meshData);
-		void load(const MeshData& meshData);
+		Mesh(const MeshData& meshData, VertexFormat vertexFormat = VertexFormat::FLOAT32, MeshUsage usage = MeshUsage::STATIC);
+		void load(const MeshData& meshData, VertexFormat vertexFormat = VertexFormat::FLOAT32, MeshUsage usage = MeshUsage::STATIC);
+		//Uploads from caller owned memory, e.g. a mapped cache file. Indices are always uploaded as 16 bit.
+		//Meshes with more than MAX_16BIT_VERTICES vertices are split into submeshes first
+		void load(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, VertexFormat vertexFormat = VertexFormat::FLOAT32, MeshUsage usage = MeshUsage::STATIC);
+		//Uploads submeshes that are already split and 16 bit, e.g. from a mapped cache file, without converting them
+		void load(const SubmeshView& view, VertexFormat vertexFormat = VertexFormat::FLOAT32, MeshUsage usage = MeshUsage::STATIC);
+		//Overwrites count vertices starting at first without touching the rest, e.g. for animated positions.
+		//Not available for STREAM meshes, which are reloaded whole, or meshes split into submeshes.
+		//Quantized formats keep the range computed by load(), so positions and uvs outside it are clamped
+		void updateVertices(size_t first, const Vertex* vertices, size_t count);
+		//Deletes the GL buffers. The mesh can be loaded again afterwards
+		void unload();
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Draws the triangles of one submesh, e.g. after culling it against its own bounds
+		void drawSubmesh(size_t index)const;
+		//Draws numIndices indices starting at firstIndex, e.g. one object of a static batch. Needs a single submesh,
+		//and draws nothing for meshes loaded without indices
+		void drawRange(size_t firstIndex, size_t numIndices)const;
+		//Draws count copies in one call per submesh. The shader tells them apart with gl_InstanceID
+		void drawInstanced(size_t count)const;
+		//Draws count copies reading per instance attributes from instances, starting at instance first
+		void drawInstanced(const InstanceBuffer& instances, size_t count, size_t first = 0)const;
+		//Vertices uploaded, including any duplicated between submeshes
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		//Model space bounds, computed by load()
+		inline const AABB& getBounds()const { return m_bounds; }
+		inline const BoundingSphere& getBoundingSphere()const { return m_boundingSphere; }
+		//One submesh covering every triangle unless the mesh had to be split
+		inline const std::vector<Submesh>& getSubmeshes()const { return m_submeshes; }
+		inline VertexFormat getVertexFormat()const { return m_vertexFormat; }
+		inline MeshUsage getUsage()const { return m_usage; }
+		//Uniforms the vertex shader needs to decode positions and uvs, see VertexFormat
+		inline const VertexQuantization& getQuantization()const { return m_quantization; }
 	private:
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
@@ -37,5 +191,29 @@ namespace ew {
 		unsigned int m_ebo = 0;
 		int m_numVertices = 0;
 		int m_numIndices = 0;
+		AABB m_bounds;
+		BoundingSphere m_boundingSphere;
+		VertexFormat m_vertexFormat = VertexFormat::FLOAT32;
+		VertexQuantization m_quantization;
+		std::vector<Submesh> m_submeshes;
+		MeshUsage m_usage = MeshUsage::STATIC;
+		//Vertices and indices the buffers have room for, per region when streaming
+		size_t m_vertexCapacity = 0;
+		size_t m_indexCapacity = 0;
+		//Start of the stream region last written, added to every draw's base vertex and first index
+		size_t m_vertexOffset = 0;
+		size_t m_indexOffset = 0;
+		int m_region = 0;
+		//Persistently mapped stream buffers
+		void* m_vertexMap = nullptr;
+		void* m_indexMap = nullptr;
+		//GLsync per stream region, signaled once draws reading it finish
+		void* m_fences[STREAM_REGIONS] = {};
+
+		void createBuffers();
+		void deleteBuffers();
+		void uploadStatic(const Vertex* vertices, size_t numVertices, const uint16_t* indices, size_t numIndices);
+		void uploadDynamic(const Vertex* vertices, size_t numVertices, const uint16_t* indices, size_t numIndices);
+		void uploadStream(const Vertex* vertices, size_t numVertices, const uint16_t* indices, size_t numIndices);
 	};
 }
\ No newline at end of file
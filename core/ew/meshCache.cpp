@@ -0,0 +1,289 @@
+#include "meshCache.h"
+#include <stdio.h>
+#include <string.h>
+#include "geometryPool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	static const char MAGIC[4] = { 'E', 'W', 'M', 'C' };
+	static const uint64_t ALIGNMENT = 16;
+
+	static uint64_t alignUp(uint64_t offset) {
+		return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+	//64 bit FNV-1a
+	static uint64_t hashKey(const std::string& key) {
+		uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : key) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//Pads file from position up to offset, then writes bytes of data after it
+	static bool writeAt(FILE* file, uint64_t* position, uint64_t offset, const void* data, size_t bytes) {
+		static const char PADDING[ALIGNMENT] = {};
+		const size_t padding = (size_t)(offset - *position);
+		*position = offset + bytes;
+		return fwrite(PADDING, 1, padding, file) == padding && (bytes == 0 || fwrite(data, 1, bytes, file) == bytes);
+	}
+
+	//True if the submeshes cover the indices in order, and every index stays within its submesh's vertices
+	static bool validSubmeshes(const MeshCacheHeader& header, const Submesh* submeshes, const uint16_t* indices) {
+		uint64_t nextIndex = 0;
+		for (uint64_t i = 0; i < header.numSubmeshes; i++) {
+			const Submesh& submesh = submeshes[i];
+			if (submesh.firstIndex != nextIndex || submesh.numIndices > header.numIndices - nextIndex
+				|| submesh.baseVertex > header.numVertices || submesh.numVertices > header.numVertices - submesh.baseVertex) {
+				return false;
+			}
+			for (size_t j = 0; j < submesh.numIndices; j++) {
+				if (indices[nextIndex + j] >= submesh.numVertices) {
+					return false;
+				}
+			}
+			nextIndex += submesh.numIndices;
+		}
+		return nextIndex == header.numIndices;
+	}
+
+	std::string MeshCacheKey(const char* generator, std::initializer_list<float> params) {
+		std::string key = generator;
+		key += '(';
+		char buffer[32];
+		bool first = true;
+		for (float param : params) {
+			snprintf(buffer, sizeof(buffer), "%s%.9g", first ? "" : ",", param);
+			key += buffer;
+			first = false;
+		}
+		key += ')';
+		return key;
+	}
+
+	MappedMesh::~MappedMesh()
+	{
+		close();
+	}
+
+	bool MappedMesh::open(const std::string& filePath)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(MeshCacheHeader)) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			CloseHandle(file);
+			return false;
+		}
+		m_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (m_data == nullptr) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		m_file = file;
+		m_mapping = mapping;
+		m_size = (size_t)size.QuadPart;
+#else
+		int file = ::open(filePath.c_str(), O_RDONLY);
+		if (file < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size < (off_t)sizeof(MeshCacheHeader)) {
+			::close(file);
+			return false;
+		}
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		//The mapping keeps the file alive
+		::close(file);
+		if (data == MAP_FAILED) {
+			return false;
+		}
+		m_data = (const char*)data;
+		m_size = (size_t)info.st_size;
+#endif
+		//Reject anything that is not a complete file of this version and vertex layout
+		const MeshCacheHeader& header = getHeader();
+		bool valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+			&& header.version == MeshCache::VERSION
+			&& header.vertexSize == sizeof(Vertex)
+			&& header.submeshSize == sizeof(Submesh)
+			&& sizeof(MeshCacheHeader) + header.keyLength <= m_size
+			&& header.verticesOffset % ALIGNMENT == 0 && header.indicesOffset % ALIGNMENT == 0 && header.submeshesOffset % ALIGNMENT == 0
+			&& header.verticesOffset <= m_size && header.indicesOffset <= m_size && header.submeshesOffset <= m_size
+			&& header.numVertices <= (m_size - header.verticesOffset) / sizeof(Vertex)
+			&& header.numIndices <= (m_size - header.indicesOffset) / sizeof(uint16_t)
+			&& header.numSubmeshes <= (m_size - header.submeshesOffset) / sizeof(Submesh);
+		//Submeshes and indices are used unchecked to read vertices later, so a corrupted or edited file is rejected here
+		valid = valid && validSubmeshes(header, getSubmeshes(), getIndices());
+		if (!valid) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	SubmeshView MappedMesh::getView() const
+	{
+		const MeshCacheHeader& header = getHeader();
+		SubmeshView view;
+		view.vertices = getVertices();
+		view.numVertices = (size_t)header.numVertices;
+		view.indices = getIndices();
+		view.numIndices = (size_t)header.numIndices;
+		view.submeshes = getSubmeshes();
+		view.numSubmeshes = (size_t)header.numSubmeshes;
+		view.bounds = header.bounds;
+		view.boundingSphere = header.boundingSphere;
+		return view;
+	}
+
+	void MappedMesh::close()
+	{
+		if (m_data == nullptr) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle((HANDLE)m_mapping);
+		CloseHandle((HANDLE)m_file);
+		m_file = m_mapping = nullptr;
+#else
+		munmap((void*)m_data, m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	MeshCache::MeshCache(const std::string& directory)
+		:m_directory(directory)
+	{
+	}
+
+	std::string MeshCache::getFilePath(const std::string& key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.ewmesh", (unsigned long long)hashKey(key));
+		return m_directory + "/" + name;
+	}
+
+	bool MeshCache::map(const std::string& key, MappedMesh* mapped) const
+	{
+		if (!mapped->open(getFilePath(key))) {
+			return false;
+		}
+		if (mapped->getKey() != key) {
+			mapped->close();
+			return false;
+		}
+		return true;
+	}
+
+	bool MeshCache::store(const std::string& key, const MeshData& meshData) const
+	{
+		SubmeshData storage;
+		return store(key, ToSubmeshView(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), &storage));
+	}
+
+	bool MeshCache::store(const std::string& key, const SubmeshView& view) const
+	{
+#ifdef _WIN32
+		_mkdir(m_directory.c_str());
+#else
+		mkdir(m_directory.c_str(), 0755);
+#endif
+		MeshCacheHeader header = {};
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.vertexSize = sizeof(Vertex);
+		header.submeshSize = sizeof(Submesh);
+		header.keyLength = (uint32_t)key.size();
+		header.numVertices = view.numVertices;
+		header.numIndices = view.numIndices;
+		header.numSubmeshes = view.numSubmeshes;
+		header.verticesOffset = alignUp(sizeof(MeshCacheHeader) + key.size());
+		header.indicesOffset = alignUp(header.verticesOffset + sizeof(Vertex) * header.numVertices);
+		header.submeshesOffset = alignUp(header.indicesOffset + sizeof(uint16_t) * header.numIndices);
+		header.bounds = view.bounds;
+		header.boundingSphere = view.boundingSphere;
+
+		//Written to a temporary file first so readers never map a partial file
+		const std::string filePath = getFilePath(key);
+		const std::string tempPath = filePath + ".tmp";
+		FILE* file = fopen(tempPath.c_str(), "wb");
+		if (file == NULL) {
+			printf("Failed to write mesh cache %s\n", tempPath.c_str());
+			return false;
+		}
+		uint64_t position = 0;
+		bool ok = writeAt(file, &position, 0, &header, sizeof(header));
+		ok = ok && writeAt(file, &position, position, key.data(), key.size());
+		ok = ok && writeAt(file, &position, header.verticesOffset, view.vertices, sizeof(Vertex) * view.numVertices);
+		ok = ok && writeAt(file, &position, header.indicesOffset, view.indices, sizeof(uint16_t) * view.numIndices);
+		ok = ok && writeAt(file, &position, header.submeshesOffset, view.submeshes, sizeof(Submesh) * view.numSubmeshes);
+		ok = fclose(file) == 0 && ok;
+		if (ok) {
+#ifdef _WIN32
+			ok = MoveFileExA(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			ok = rename(tempPath.c_str(), filePath.c_str()) == 0;
+#endif
+		}
+		if (!ok) {
+			remove(tempPath.c_str());
+			printf("Failed to write mesh cache %s\n", filePath.c_str());
+		}
+		return ok;
+	}
+
+	void MeshCache::load(const std::string& key, Mesh* mesh, const std::function<MeshData()>& generate, VertexFormat vertexFormat) const
+	{
+		MappedMesh mapped;
+		if (map(key, &mapped)) {
+			mesh->load(mapped.getView(), vertexFormat);
+			return;
+		}
+		//Split once, for both the file and the upload
+		const MeshData meshData = generate();
+		SubmeshData storage;
+		const SubmeshView view = ToSubmeshView(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), &storage);
+		store(key, view);
+		mesh->load(view, vertexFormat);
+	}
+
+	size_t MeshCache::load(const std::string& key, GeometryPool* pool, const std::function<MeshData()>& generate) const
+	{
+		MappedMesh mapped;
+		if (map(key, &mapped)) {
+			return pool->add(mapped.getView());
+		}
+		const MeshData meshData = generate();
+		SubmeshData storage;
+		const SubmeshView view = ToSubmeshView(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), &storage);
+		store(key, view);
+		return pool->add(view);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <functional>
+#include <initializer_list>
+#include "mesh.h"
+
+namespace ew {
+	class GeometryPool;
+
+	//Builds a cache key from a generator name and its parameters, e.g. MeshCacheKey("ew::createSphere", { 0.5f, 64 }).
+	//Parameters are printed with enough digits to round trip, so distinct values never share a key
+	std::string MeshCacheKey(const char* generator, std::initializer_list<float> params);
+
+	//Layout of a cache file. Meshes are stored already split into submeshes with 16 bit indices, as Mesh uploads them.
+	//Vertex, index and submesh arrays follow at the given byte offsets, aligned to 16 bytes,
+	//so a mapped file can be handed to the GPU without parsing
+	struct MeshCacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexSize;
+		uint32_t submeshSize; //sizeof(Submesh) depends on the platform's size_t
+		uint32_t keyLength; //Key bytes follow the header, to reject hash collisions
+		uint32_t padding;
+		uint64_t numVertices;
+		uint64_t numIndices;
+		uint64_t numSubmeshes;
+		uint64_t verticesOffset;
+		uint64_t indicesOffset;
+		uint64_t submeshesOffset;
+		AABB bounds;
+		BoundingSphere boundingSphere;
+	};
+
+	//Read only view of a cache file mapped into memory. Unmapped on destruction
+	class MappedMesh {
+	public:
+		MappedMesh() {};
+		~MappedMesh();
+		MappedMesh(const MappedMesh&) = delete;
+		MappedMesh& operator=(const MappedMesh&) = delete;
+
+		//Maps filePath. Returns false if it is missing, truncated, not a cache file of this version
+		//or has a submesh or index past the end of its arrays
+		bool open(const std::string& filePath);
+		void close();
+		inline bool isOpen()const { return m_data != nullptr; }
+		inline const MeshCacheHeader& getHeader()const { return *reinterpret_cast<const MeshCacheHeader*>(m_data); }
+		inline const Vertex* getVertices()const { return reinterpret_cast<const Vertex*>(m_data + getHeader().verticesOffset); }
+		inline const uint16_t* getIndices()const { return reinterpret_cast<const uint16_t*>(m_data + getHeader().indicesOffset); }
+		inline const Submesh* getSubmeshes()const { return reinterpret_cast<const Submesh*>(m_data + getHeader().submeshesOffset); }
+		inline size_t getNumVertices()const { return getHeader().numVertices; }
+		inline size_t getNumIndices()const { return getHeader().numIndices; }
+		inline size_t getNumSubmeshes()const { return getHeader().numSubmeshes; }
+		//Points into the mapping, so it is only valid while the file stays open
+		SubmeshView getView()const;
+		inline std::string getKey()const { return std::string(m_data + sizeof(MeshCacheHeader), getHeader().keyLength); }
+
+	private:
+		const char* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+
+	//Persistent on disk cache of generated meshes, one file per key
+	class MeshCache {
+	public:
+		//Bump when the file layout or Vertex changes so stale files are regenerated
+		static const uint32_t VERSION = 2;
+
+		//directory is created on the first store if it does not exist
+		MeshCache(const std::string& directory);
+		std::string getFilePath(const std::string& key)const;
+		//Maps the cached mesh for key. Returns false on a miss
+		bool map(const std::string& key, MappedMesh* mapped)const;
+		//Writes meshData for key, replacing any existing file. Returns false if the file could not be written
+		bool store(const std::string& key, const MeshData& meshData)const;
+		bool store(const std::string& key, const SubmeshView& view)const;
+		//Uploads the cached mesh for key into mesh. On a miss, calls generate, stores the result and uploads it.
+		//Files always hold FLOAT32 vertices, which are encoded to vertexFormat on upload
+		void load(const std::string& key, Mesh* mesh, const std::function<MeshData()>& generate, VertexFormat vertexFormat = VertexFormat::FLOAT32)const;
+		//Same, adding the mesh to pool. Returns its handle
+		size_t load(const std::string& key, GeometryPool* pool, const std::function<MeshData()>& generate)const;
+
+	private:
+		std::string m_directory;
+	};
+}
@@ -0,0 +1,457 @@
+#include "meshOptimizer.h"
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace ew {
+	static const unsigned int NO_TRIANGLE = ~0u;
+
+	namespace {
+		//FIFO post-transform cache. A vertex is cached if it was inserted within the last size misses
+		struct FifoCache {
+			std::vector<unsigned int> insertedAt;
+			unsigned int time;
+			unsigned int size;
+
+			FifoCache(size_t numVertices, unsigned int size)
+				:insertedAt(numVertices, 0), time(size + 1), size(size) {}
+			//Returns true on a miss
+			inline bool access(unsigned int vertex) {
+				if (time - insertedAt[vertex] > size) {
+					insertedAt[vertex] = time++;
+					return true;
+				}
+				return false;
+			}
+			inline void flush() {
+				time += size + 1;
+			}
+		};
+
+		//Tom Forsyth, "Linear-Speed Vertex Cache Optimisation". Scores are tabulated by LRU position and remaining valence
+		struct ForsythScores {
+			static const int CACHE_SIZE = 32;
+			static const int VALENCE_TABLE_SIZE = 64;
+			float cache[CACHE_SIZE];
+			float valence[VALENCE_TABLE_SIZE];
+
+			ForsythScores() {
+				const float CACHE_DECAY_POWER = 1.5f;
+				const float LAST_TRIANGLE_SCORE = 0.75f;
+				const float VALENCE_BOOST_SCALE = 2.0f;
+				const float VALENCE_BOOST_POWER = 0.5f;
+				for (int i = 0; i < CACHE_SIZE; i++) {
+					//The last triangle's vertices score a fixed amount, so the next triangle does not just reuse its newest edge
+					cache[i] = i < 3 ? LAST_TRIANGLE_SCORE : powf(1.0f - (i - 3) / (float)(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+				}
+				valence[0] = 0.0f;
+				for (int i = 1; i < VALENCE_TABLE_SIZE; i++) {
+					valence[i] = VALENCE_BOOST_SCALE * powf((float)i, -VALENCE_BOOST_POWER);
+				}
+			}
+			//cachePosition is -1 for vertices outside the cache
+			inline float score(int cachePosition, unsigned int remaining) const {
+				if (remaining == 0) {
+					return -1.0f;
+				}
+				const float cacheScore = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+				const float valenceScore = remaining < VALENCE_TABLE_SIZE ? valence[remaining] : 2.0f / sqrtf((float)remaining);
+				return cacheScore + valenceScore;
+			}
+		};
+	}
+
+	VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVertices, unsigned int cacheSize)
+	{
+		VertexCacheStats stats = {};
+		FifoCache cache(numVertices, cacheSize);
+		std::vector<char> referenced(numVertices, 0);
+		size_t numReferenced = 0;
+		for (size_t i = 0; i < numIndices; i++) {
+			const unsigned int vertex = indices[i];
+			stats.vertexTransforms += cache.access(vertex);
+			if (!referenced[vertex]) {
+				referenced[vertex] = 1;
+				numReferenced++;
+			}
+		}
+		const size_t numTriangles = numIndices / 3;
+		stats.acmr = numTriangles > 0 ? stats.vertexTransforms / (float)numTriangles : 0.0f;
+		stats.atvr = numReferenced > 0 ? stats.vertexTransforms / (float)numReferenced : 0.0f;
+		return stats;
+	}
+
+	void optimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVertices)
+	{
+		static const ForsythScores scores;
+		const int CACHE_SIZE = ForsythScores::CACHE_SIZE;
+		const size_t numTriangles = numIndices / 3;
+		if (numTriangles == 0) {
+			return;
+		}
+
+		//Triangles using each vertex. The first remaining[v] entries of a vertex's range are the ones not yet emitted
+		std::vector<unsigned int> remaining(numVertices, 0);
+		for (size_t i = 0; i < numTriangles * 3; i++) {
+			remaining[indices[i]]++;
+		}
+		std::vector<unsigned int> adjacencyOffsets(numVertices + 1);
+		adjacencyOffsets[0] = 0;
+		for (size_t v = 0; v < numVertices; v++) {
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+		}
+		std::vector<unsigned int> adjacency(numTriangles * 3);
+		{
+			std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < numTriangles * 3; i++) {
+				adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+			}
+		}
+
+		std::vector<int> cachePosition(numVertices, -1);
+		std::vector<float> vertexScore(numVertices);
+		for (size_t v = 0; v < numVertices; v++) {
+			vertexScore[v] = scores.score(-1, remaining[v]);
+		}
+		std::vector<float> triangleScore(numTriangles);
+		unsigned int best = 0;
+		for (size_t t = 0; t < numTriangles; t++) {
+			const unsigned int* tri = &indices[t * 3];
+			triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+			if (triangleScore[t] > triangleScore[best]) {
+				best = (unsigned int)t;
+			}
+		}
+
+		std::vector<char> emitted(numTriangles, 0);
+		std::vector<unsigned int> output(numTriangles * 3);
+		//LRU order, most recent first. Holds up to 3 extra entries while a triangle is added
+		unsigned int cache[CACHE_SIZE + 3];
+		unsigned int newCache[CACHE_SIZE + 3];
+		int cacheCount = 0;
+		size_t nextUnemitted = 0;
+		for (size_t out = 0; out < numTriangles; out++) {
+			if (best == NO_TRIANGLE) {
+				//Nothing in the cache has triangles left, so restart from the first triangle not yet emitted
+				while (emitted[nextUnemitted]) {
+					nextUnemitted++;
+				}
+				best = (unsigned int)nextUnemitted;
+			}
+			emitted[best] = 1;
+			const unsigned int* tri = &indices[best * 3];
+			memcpy(&output[out * 3], tri, 3 * sizeof(unsigned int));
+
+			//Emitted triangle's vertices move to the front of the cache
+			int newCount = 0;
+			for (int k = 0; k < 3; k++) {
+				if (std::find(newCache, newCache + newCount, tri[k]) == newCache + newCount) {
+					newCache[newCount++] = tri[k];
+				}
+			}
+			for (int i = 0; i < cacheCount; i++) {
+				if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2]) {
+					newCache[newCount++] = cache[i];
+				}
+			}
+			for (int k = 0; k < 3; k++) {
+				const unsigned int v = tri[k];
+				unsigned int* first = &adjacency[adjacencyOffsets[v]];
+				unsigned int* last = first + remaining[v] - 1;
+				unsigned int* found = std::find(first, last, best);
+				*found = *last;
+				remaining[v]--;
+			}
+
+			//Rescore every vertex whose cache position changed, including those pushed out, then their triangles
+			for (int i = 0; i < newCount; i++) {
+				const unsigned int v = newCache[i];
+				cachePosition[v] = i < CACHE_SIZE ? i : -1;
+				vertexScore[v] = scores.score(cachePosition[v], remaining[v]);
+			}
+			best = NO_TRIANGLE;
+			float bestScore = -1.0f;
+			for (int i = 0; i < newCount; i++) {
+				const unsigned int v = newCache[i];
+				const unsigned int* adjacent = &adjacency[adjacencyOffsets[v]];
+				for (unsigned int j = 0; j < remaining[v]; j++) {
+					const unsigned int t = adjacent[j];
+					const unsigned int* other = &indices[t * 3];
+					triangleScore[t] = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+					if (triangleScore[t] > bestScore) {
+						bestScore = triangleScore[t];
+						best = t;
+					}
+				}
+			}
+			cacheCount = newCount < CACHE_SIZE ? newCount : CACHE_SIZE;
+			memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+		}
+		memcpy(indices, output.data(), numTriangles * 3 * sizeof(unsigned int));
+	}
+
+	void optimizeOverdraw(unsigned int* indices, size_t numIndices, const Vertex* vertices, size_t numVertices, float threshold)
+	{
+		//Same cache size analyzeVertexCache defaults to
+		const unsigned int CACHE_SIZE = 16;
+		const size_t numTriangles = numIndices / 3;
+		if (numTriangles == 0) {
+			return;
+		}
+
+		//Hard boundaries: triangles where all three vertices miss, so the optimized order started over
+		std::vector<size_t> hardBoundaries;
+		{
+			FifoCache cache(numVertices, CACHE_SIZE);
+			for (size_t t = 0; t < numTriangles; t++) {
+				const unsigned int* tri = &indices[t * 3];
+				const int misses = cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+				if (t == 0 || misses == 3) {
+					hardBoundaries.push_back(t);
+				}
+			}
+			hardBoundaries.push_back(numTriangles);
+		}
+
+		//Soft boundaries: split a hard cluster wherever its running ACMR is within threshold of the whole cluster's
+		std::vector<size_t> clusterStarts;
+		{
+			FifoCache cache(numVertices, CACHE_SIZE);
+			for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+				const size_t start = hardBoundaries[h];
+				const size_t end = hardBoundaries[h + 1];
+				cache.flush();
+				size_t clusterMisses = 0;
+				for (size_t t = start; t < end; t++) {
+					const unsigned int* tri = &indices[t * 3];
+					clusterMisses += cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+				}
+				const float clusterThreshold = threshold * clusterMisses / (float)(end - start);
+
+				clusterStarts.push_back(start);
+				cache.flush();
+				size_t runningMisses = 0;
+				size_t runningTriangles = 0;
+				for (size_t t = start; t < end; t++) {
+					const unsigned int* tri = &indices[t * 3];
+					runningMisses += cache.access(tri[0]) + cache.access(tri[1]) + cache.access(tri[2]);
+					runningTriangles++;
+					if (t + 1 < end && runningMisses <= clusterThreshold * runningTriangles) {
+						clusterStarts.push_back(t + 1);
+						//The new cluster may be drawn anywhere, so it cannot count on this one's cache
+						cache.flush();
+						runningMisses = runningTriangles = 0;
+					}
+				}
+			}
+			clusterStarts.push_back(numTriangles);
+		}
+		const size_t numClusters = clusterStarts.size() - 1;
+
+		//Area weighted centroid and normal of each cluster
+		std::vector<Vec3> clusterCentroids(numClusters);
+		std::vector<Vec3> clusterNormals(numClusters);
+		Vec3 meshCentroid = Vec3(0);
+		float meshArea = 0.0f;
+		for (size_t c = 0; c < numClusters; c++) {
+			Vec3 centroid = Vec3(0);
+			Vec3 normal = Vec3(0);
+			float area = 0.0f;
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+				const Vec3& p0 = vertices[indices[t * 3]].pos;
+				const Vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+				const Vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+				const Vec3 cross = Cross(p1 - p0, p2 - p0);
+				const float triangleArea = Magnitude(cross);
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal += cross;
+				area += triangleArea;
+			}
+			meshCentroid += centroid;
+			meshArea += area;
+			clusterCentroids[c] = area > 0.0f ? centroid / area : centroid;
+			clusterNormals[c] = normal;
+		}
+		if (meshArea > 0.0f) {
+			meshCentroid = meshCentroid / meshArea;
+		}
+
+		//Clusters facing away from the center tend to occlude the rest, so draw them first
+		std::vector<float> sortKeys(numClusters);
+		std::vector<size_t> order(numClusters);
+		for (size_t c = 0; c < numClusters; c++) {
+			const float normalLength = Magnitude(clusterNormals[c]);
+			sortKeys[c] = normalLength > 0.0f ? Dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]) / normalLength : 0.0f;
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<unsigned int> output;
+		output.reserve(numTriangles * 3);
+		for (size_t c : order) {
+			output.insert(output.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+		}
+		memcpy(indices, output.data(), numTriangles * 3 * sizeof(unsigned int));
+	}
+
+	void optimizeVertexFetch(MeshData& meshData)
+	{
+		const unsigned int UNASSIGNED = ~0u;
+		const size_t numVertices = meshData.vertices.size();
+		std::vector<unsigned int> remap(numVertices, UNASSIGNED);
+		unsigned int next = 0;
+		for (unsigned int index : meshData.indices) {
+			if (remap[index] == UNASSIGNED) {
+				remap[index] = next++;
+			}
+		}
+		for (size_t v = 0; v < numVertices; v++) {
+			if (remap[v] == UNASSIGNED) {
+				remap[v] = next++;
+			}
+		}
+		std::vector<Vertex> vertices(numVertices);
+		for (size_t v = 0; v < numVertices; v++) {
+			vertices[remap[v]] = meshData.vertices[v];
+		}
+		meshData.vertices.swap(vertices);
+		for (unsigned int& index : meshData.indices) {
+			index = remap[index];
+		}
+	}
+
+	MeshOptimizeStats optimizeMesh(MeshData& meshData)
+	{
+		MeshOptimizeStats stats;
+		unsigned int* indices = meshData.indices.data();
+		const size_t numIndices = meshData.indices.size();
+		const size_t numVertices = meshData.vertices.size();
+		stats.before = analyzeVertexCache(indices, numIndices, numVertices);
+		optimizeVertexCache(indices, numIndices, numVertices);
+		optimizeOverdraw(indices, numIndices, meshData.vertices.data(), numVertices);
+		optimizeVertexFetch(meshData);
+		stats.after = analyzeVertexCache(meshData.indices.data(), numIndices, numVertices);
+		return stats;
+	}
+
+	namespace {
+		inline bool withinTolerance(const Vec3& a, const Vec3& b, float tolerance) {
+			return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance && fabsf(a.z - b.z) <= tolerance;
+		}
+		inline bool withinTolerance(const Vec2& a, const Vec2& b, float tolerance) {
+			return fabsf(a.x - b.x) <= tolerance && fabsf(a.y - b.y) <= tolerance;
+		}
+
+		//Grid cell of a coordinate. Cells are at least as wide as the tolerance, so matches are at most one cell apart.
+		//A cell size of 0 welds exact matches only, so the cell is the coordinate's bit pattern
+		inline int64_t weldCell(float x, double cellSize) {
+			if (cellSize == 0.0) {
+				uint32_t bits;
+				const float normalized = x + 0.0f; //-0 and +0 match
+				memcpy(&bits, &normalized, sizeof(bits));
+				return bits;
+			}
+			const double cell = floor((double)x / cellSize);
+			//Only reached by infinities and NaN, since the cell size is kept large enough for the mesh
+			const double LIMIT = 4.0e18;
+			return cell != cell ? 0 : (int64_t)(cell < -LIMIT ? -LIMIT : cell > LIMIT ? LIMIT : cell);
+		}
+
+		inline uint64_t hashCell(int64_t x, int64_t y, int64_t z) {
+			uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ull;
+			h ^= (uint64_t)y * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+			h ^= (uint64_t)z * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+			return h;
+		}
+	}
+
+	WeldStats weldVertices(MeshData& meshData, const WeldSettings& settings)
+	{
+		const unsigned int NONE = ~0u;
+		const size_t numVertices = meshData.vertices.size();
+		const std::vector<Vertex>& vertices = meshData.vertices;
+		WeldStats stats;
+		stats.verticesBefore = numVertices;
+
+		//Tiny tolerances get wider cells, so cell coordinates stay in range. At most 2^40 cells per axis keeps
+		//neighbors apart while wider cells only add candidates, which are all compared in full
+		double cellSize = 0.0;
+		int reach = 0;
+		if (settings.positionTolerance > 0.0f) {
+			float largest = 0.0f;
+			for (const Vertex& vertex : vertices) {
+				largest = fmaxf(largest, fmaxf(fabsf(vertex.pos.x), fmaxf(fabsf(vertex.pos.y), fabsf(vertex.pos.z))));
+			}
+			cellSize = fmax((double)settings.positionTolerance, largest * (1.0 / (1ull << 40)));
+			reach = 1;
+		}
+		//Kept vertices in each cell, chained through next
+		std::unordered_map<uint64_t, unsigned int> cellHeads;
+		cellHeads.reserve(numVertices);
+		std::vector<unsigned int> next;
+		std::vector<unsigned int> kept;
+		std::vector<unsigned int> remap(numVertices);
+		for (size_t v = 0; v < numVertices; v++) {
+			const Vertex& vertex = vertices[v];
+			const int64_t cx = weldCell(vertex.pos.x, cellSize);
+			const int64_t cy = weldCell(vertex.pos.y, cellSize);
+			const int64_t cz = weldCell(vertex.pos.z, cellSize);
+			unsigned int match = NONE;
+			for (int dx = -reach; dx <= reach && match == NONE; dx++) {
+				for (int dy = -reach; dy <= reach && match == NONE; dy++) {
+					for (int dz = -reach; dz <= reach && match == NONE; dz++) {
+						auto found = cellHeads.find(hashCell(cx + dx, cy + dy, cz + dz));
+						for (unsigned int k = found != cellHeads.end() ? found->second : NONE; k != NONE; k = next[k]) {
+							const Vertex& other = vertices[kept[k]];
+							//Hash collisions between cells are harmless, since every candidate is compared in full
+							if (withinTolerance(vertex.pos, other.pos, settings.positionTolerance)
+								&& withinTolerance(vertex.normal, other.normal, settings.normalTolerance)
+								&& withinTolerance(vertex.uv, other.uv, settings.uvTolerance)) {
+								match = k;
+								break;
+							}
+						}
+					}
+				}
+			}
+			if (match == NONE) {
+				match = (unsigned int)kept.size();
+				kept.push_back((unsigned int)v);
+				const uint64_t cell = hashCell(cx, cy, cz);
+				auto found = cellHeads.find(cell);
+				next.push_back(found != cellHeads.end() ? found->second : NONE);
+				cellHeads[cell] = match;
+			}
+			remap[v] = match;
+		}
+
+		std::vector<Vertex> welded(kept.size());
+		for (size_t k = 0; k < kept.size(); k++) {
+			welded[k] = vertices[kept[k]];
+		}
+		meshData.vertices.swap(welded);
+		stats.verticesAfter = meshData.vertices.size();
+
+		std::vector<unsigned int>& indices = meshData.indices;
+		size_t out = 0;
+		stats.degenerateTriangles = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const unsigned int a = remap[indices[i]];
+			const unsigned int b = remap[indices[i + 1]];
+			const unsigned int c = remap[indices[i + 2]];
+			const bool degenerate = a == b || b == c || a == c;
+			stats.degenerateTriangles += degenerate;
+			if (degenerate && settings.removeDegenerateTriangles) {
+				continue;
+			}
+			indices[out++] = a;
+			indices[out++] = b;
+			indices[out++] = c;
+		}
+		indices.resize(out);
+		return stats;
+	}
+}
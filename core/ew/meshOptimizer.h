@@ -0,0 +1,58 @@
+#pragma once
+#include <stddef.h>
+#include <float.h>
+#include "mesh.h"
+
+namespace ew {
+	//Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+	struct VertexCacheStats {
+		size_t vertexTransforms; //Cache misses, i.e. vertex shader invocations
+		float acmr; //Average cache miss ratio, transforms per triangle. 0.5 is ideal for large grids, 3 is worst
+		float atvr; //Average transform to vertex ratio, transforms per referenced vertex. 1 is ideal
+	};
+
+	struct MeshOptimizeStats {
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+
+	//Simulates a FIFO post-transform cache of cacheSize entries over a triangle list
+	VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t numIndices, size_t numVertices, unsigned int cacheSize = 16);
+
+	//Reorders triangles for post-transform cache locality with Forsyth's linear speed algorithm
+	void optimizeVertexCache(unsigned int* indices, size_t numIndices, size_t numVertices);
+
+	//Reorders clusters of cache-optimized triangles so outward facing clusters draw first, which improves early-z rejection.
+	//Clusters are split where the cache state resets, and further wherever the cluster's running ACMR falls within threshold
+	//of its final ACMR, so cache efficiency degrades by at most that factor. Run after optimizeVertexCache
+	void optimizeOverdraw(unsigned int* indices, size_t numIndices, const Vertex* vertices, size_t numVertices, float threshold = 1.05f);
+
+	//Reorders vertices into the order the index buffer first references them and remaps the indices.
+	//Unreferenced vertices are kept at the end
+	void optimizeVertexFetch(MeshData& meshData);
+
+	//Runs the vertex cache, overdraw and vertex fetch passes in that order and returns cache statistics before and after
+	MeshOptimizeStats optimizeMesh(MeshData& meshData);
+
+	struct WeldSettings {
+		//Largest difference per component at which attributes still count as equal.
+		//FLT_MAX ignores an attribute, e.g. uvTolerance = FLT_MAX welds across uv seams
+		float positionTolerance = 1e-6f;
+		float normalTolerance = 1e-3f;
+		float uvTolerance = 1e-6f;
+		//Drop triangles that welding left with fewer than 3 distinct vertices
+		bool removeDegenerateTriangles = true;
+	};
+
+	struct WeldStats {
+		size_t verticesBefore;
+		size_t verticesAfter;
+		size_t degenerateTriangles; //Removed, or left in place if removeDegenerateTriangles is off
+		inline size_t verticesSaved()const { return verticesBefore - verticesAfter; }
+	};
+
+	//Merges vertices whose position, normal and uv all match within tolerance, remaps the indices and compacts
+	//the vertex array. Each vertex joins the first earlier vertex it matches, found through a spatial hash of positions.
+	//Run before optimizeMesh, since it changes which vertices triangles share
+	WeldStats weldVertices(MeshData& meshData, const WeldSettings& settings = WeldSettings());
+}
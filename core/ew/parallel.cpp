@@ -0,0 +1,141 @@
+#include "parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ew {
+	//Chunks handed out per worker, so uneven chunks balance out
+	static const size_t CHUNKS_PER_WORKER = 4;
+
+	unsigned int GetWorkerCount() {
+		static const unsigned int count = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+		return count;
+	}
+
+	namespace {
+		//One ParallelFor call. Lives on the caller's stack until every worker has let go of it
+		struct Job {
+			const std::function<void(size_t, size_t)>* func;
+			size_t begin, end, chunkSize, numChunks;
+			std::atomic<size_t> nextChunk;
+			//Workers currently inside run(). Guarded by the pool mutex
+			unsigned int activeWorkers;
+
+			//Claims and runs chunks until none are left
+			void run() {
+				for (size_t chunk = nextChunk.fetch_add(1); chunk < numChunks; chunk = nextChunk.fetch_add(1)) {
+					const size_t chunkBegin = begin + chunk * chunkSize;
+					const size_t chunkEnd = chunkBegin + chunkSize < end ? chunkBegin + chunkSize : end;
+					(*func)(chunkBegin, chunkEnd);
+				}
+			}
+		};
+
+		//GetWorkerCount() - 1 threads that live for the rest of the program. The calling thread is the last worker
+		class ThreadPool {
+		public:
+			ThreadPool() {
+				const unsigned int count = GetWorkerCount() - 1;
+				m_threads.reserve(count);
+				for (unsigned int i = 0; i < count; i++) {
+					m_threads.emplace_back(&ThreadPool::workerLoop, this);
+				}
+			}
+			~ThreadPool() {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+				m_jobAdded.notify_all();
+				for (std::thread& thread : m_threads) {
+					thread.join();
+				}
+			}
+			void execute(Job& job) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_jobs.push_back(&job);
+				}
+				m_jobAdded.notify_all();
+				job.run();
+				//Every chunk is claimed. Unpublish the job and wait for workers still finishing theirs
+				std::unique_lock<std::mutex> lock(m_mutex);
+				removeJob(&job);
+				m_workerLeft.wait(lock, [&job] { return job.activeWorkers == 0; });
+			}
+
+		private:
+			void workerLoop() {
+				std::unique_lock<std::mutex> lock(m_mutex);
+				for (;;) {
+					m_jobAdded.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+					if (m_stop) {
+						return;
+					}
+					Job* job = m_jobs.front();
+					job->activeWorkers++;
+					lock.unlock();
+					job->run();
+					lock.lock();
+					removeJob(job);
+					if (--job->activeWorkers == 0) {
+						m_workerLeft.notify_all();
+					}
+				}
+			}
+			void removeJob(Job* job) {
+				for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+					if (*it == job) {
+						m_jobs.erase(it);
+						return;
+					}
+				}
+			}
+
+			std::vector<std::thread> m_threads;
+			std::deque<Job*> m_jobs;
+			std::mutex m_mutex;
+			std::condition_variable m_jobAdded;
+			std::condition_variable m_workerLeft;
+			bool m_stop = false;
+		};
+
+		ThreadPool& getThreadPool() {
+			//Started on first use, joined at exit
+			static ThreadPool pool;
+			return pool;
+		}
+	}
+
+	void ParallelFor(size_t begin, size_t end, size_t minChunk, const std::function<void(size_t, size_t)>& func) {
+		if (end <= begin) {
+			return;
+		}
+		const size_t count = end - begin;
+		if (minChunk == 0) {
+			minChunk = 1;
+		}
+		const size_t maxChunks = (size_t)GetWorkerCount() * CHUNKS_PER_WORKER;
+		size_t numChunks = count / minChunk;
+		if (numChunks > maxChunks) {
+			numChunks = maxChunks;
+		}
+		if (numChunks <= 1 || GetWorkerCount() == 1) {
+			func(begin, end);
+			return;
+		}
+
+		Job job;
+		job.func = &func;
+		job.begin = begin;
+		job.end = end;
+		job.chunkSize = (count + numChunks - 1) / numChunks;
+		job.numChunks = (count + job.chunkSize - 1) / job.chunkSize;
+		job.nextChunk = 0;
+		job.activeWorkers = 0;
+		getThreadPool().execute(job);
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stddef.h>
+#include <functional>
+
+namespace ew {
+	//Number of threads ParallelFor splits work across
+	unsigned int GetWorkerCount();
+
+	//Splits [begin, end) into contiguous chunks of at least minChunk elements and calls func(chunkBegin, chunkEnd) for each.
+	//Chunks run concurrently on a persistent thread pool and the calling thread, so func must only write to data owned
+	//by its own range. Returns once every chunk has finished.
+	//Runs serially on the calling thread when the range is too small to be worth splitting.
+	//Safe to call from several threads at once and from inside func.
+	//Handing a chunk to a pooled worker and waiting for it costs on the order of 10 microseconds, so pick minChunk
+	//to cover around 100 microseconds of work. Cheaper per element loops need proportionally larger chunks
+	void ParallelFor(size_t begin, size_t end, size_t minChunk, const std::function<void(size_t, size_t)>& func);
+	//minChunk for loops that spend on the order of 10 ns per element, such as per vertex work
+	const size_t DEFAULT_MIN_CHUNK = 16384;
+}
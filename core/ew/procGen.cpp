@@ -4,19 +4,46 @@
 
 
 #include "procGen.h"
+#include "parallel.h"
+#include "ringTable.h"
 #include <stdlib.h>
 
 namespace ew {
+	static const size_t MIN_ELEMENTS_PER_THREAD = DEFAULT_MIN_CHUNK;
+	//Rows of rowLength elements that make up one chunk of parallel work. Empty rows, e.g. 0 subdivisions, count as one
+	static size_t minRowsPerThread(size_t rowLength) {
+		return rowLength == 0 || rowLength >= MIN_ELEMENTS_PER_THREAD ? 1 : MIN_ELEMENTS_PER_THREAD / rowLength;
+	}
+	//Normal, U axis and V axis of a cube face
+	struct CubeFace {
+		ew::Vec3 normal;
+		ew::Vec3 a;
+		ew::Vec3 b;
+	};
+	static constexpr CubeFace makeCubeFace(ew::Vec3 normal) {
+		return CubeFace{ normal, ew::Vec3(normal.z, normal.x, normal.y), ew::Cross(normal, ew::Vec3(normal.z, normal.x, normal.y)) };
+	}
+	//Face bases are folded at compile time
+	static constexpr CubeFace CUBE_FACES[6] = {
+		makeCubeFace(ew::Vec3{ +0.0f,+0.0f,+1.0f }), //Front
+		makeCubeFace(ew::Vec3{ +1.0f,+0.0f,+0.0f }), //Right
+		makeCubeFace(ew::Vec3{ +0.0f,+1.0f,+0.0f }), //Top
+		makeCubeFace(ew::Vec3{ -1.0f,+0.0f,+0.0f }), //Left
+		makeCubeFace(ew::Vec3{ +0.0f,-1.0f,+0.0f }), //Bottom
+		makeCubeFace(ew::Vec3{ +0.0f,+0.0f,-1.0f }) //Back
+	};
 	/// <summary>
 	/// Helper function for createCube. Note that this is not meant to be used standalone
 	/// </summary>
-	/// <param name="normal">Normal direction of the face</param>
+	/// <param name="face">Normal and U/V axes of the face</param>
 	/// <param name="size">Width/height of the face</param>
-	/// <param name="mesh">MeshData struct to fill</param>
-	static void createCubeFace(ew::Vec3 normal, float size, MeshData* mesh) {
-		unsigned int startVertex = mesh->vertices.size();
-		ew::Vec3 a = ew::Vec3(normal.z, normal.x, normal.y); //U axis
-		ew::Vec3 b = ew::Cross(normal, a); //V axis
+	/// <param name="startVertex">Index of the face's first vertex</param>
+	/// <param name="vertices">Receives 4 vertices</param>
+	/// <param name="indices">Receives 6 indices</param>
+	static void createCubeFace(const CubeFace& face, float size, unsigned int startVertex, Vertex* vertices, unsigned int* indices) {
+		const ew::Vec3& normal = face.normal;
+		const ew::Vec3& a = face.a; //U axis
+		const ew::Vec3& b = face.b; //V axis
 		for (int i = 0; i < 4; i++)
 		{
 			int col = i % 2;
@@ -25,178 +52,229 @@ namespace ew {
 			ew::Vec3 pos = normal * size * 0.5f;
 			pos -= (a + b) * size * 0.5f;
 			pos += (a * col + b * row) * size;
-			Vertex vertex;
+			Vertex& vertex = vertices[i];
 			vertex.pos = pos;
 			vertex.normal = normal;
 			vertex.uv = ew::Vec2(col, row);
-			mesh->vertices.push_back(vertex);
 		}
 
 		//Indices
-		mesh->indices.push_back(startVertex);
-		mesh->indices.push_back(startVertex + 1);
-		mesh->indices.push_back(startVertex + 3);
-		mesh->indices.push_back(startVertex + 3);
-		mesh->indices.push_back(startVertex + 2);
-		mesh->indices.push_back(startVertex);
+		indices[0] = startVertex;
+		indices[1] = startVertex + 1;
+		indices[2] = startVertex + 3;
+		indices[3] = startVertex + 3;
+		indices[4] = startVertex + 2;
+		indices[5] = startVertex;
+	}
+	MeshSize getCubeSize() {
+		return MeshSize{ 24, 36 }; //6 x 4 vertices, 6 x 6 indices
+	}
+	MeshSize getPlaneSize(int subdivisions) {
+		const size_t columns = subdivisions + 1;
+		return MeshSize{ columns * columns, (size_t)subdivisions * subdivisions * 6 };
+	}
+	MeshSize getSphereSize(int subdivisions) {
+		const size_t columns = subdivisions + 1;
+		//Two caps of one triangle per column, plus quads for every row between the rows touching the poles
+		const size_t sideRows = subdivisions > 2 ? subdivisions - 2 : 0;
+		return MeshSize{ columns * columns, (size_t)subdivisions * 6 + sideRows * subdivisions * 6 };
+	}
+	MeshSize getCylinderSize(int subdivisions) {
+		const size_t columns = subdivisions + 1;
+		//Center vertices and 4 rings. Caps and sides emit one triangle (pair) per ring vertex
+		return MeshSize{ columns * 4 + 2, columns * 12 };
 	}
 	/// <summary>
 	/// Creates a cube of uniform size
 	/// </summary>
 	/// <param name="size">Total width, height, depth</param>
-	/// <param name="mesh">MeshData struct to fill. Will be cleared.</param>
 	MeshData createCube(float size) {
-		MeshData mesh;
-		mesh.vertices.reserve(24); //6 x 4 vertices
-		mesh.indices.reserve(36); //6 x 6 indices
-		createCubeFace(ew::Vec3{ +0.0f,+0.0f,+1.0f }, size, &mesh); //Front
-		createCubeFace(ew::Vec3{ +1.0f,+0.0f,+0.0f }, size, &mesh); //Right
-		createCubeFace(ew::Vec3{ +0.0f,+1.0f,+0.0f }, size, &mesh); //Top
-		createCubeFace(ew::Vec3{ -1.0f,+0.0f,+0.0f }, size, &mesh); //LeftHN
-		createCubeFace(ew::Vec3{ +0.0f,-1.0f,+0.0f }, size, &mesh); //Bottom
-		createCubeFace(ew::Vec3{ +0.0f,+0.0f,-1.0f }, size, &mesh); //Back
+		MeshData mesh = AllocateMeshData(getCubeSize());
+		createCube(size, mesh.vertices.data(), mesh.indices.data());
 		return mesh;
 	}
+	void createCube(float size, Vertex* vertices, unsigned int* indices) {
+		for (unsigned int i = 0; i < 6; i++) {
+			createCubeFace(CUBE_FACES[i], size, i * 4, vertices + i * 4, indices + i * 6);
+		}
+	}
 	MeshData createPlane(float width, float height, int subdivisions)
 	{
+		MeshData mesh = AllocateMeshData(getPlaneSize(subdivisions));
+		createPlane(width, height, subdivisions, mesh.vertices.data(), mesh.indices.data());
+		return mesh;
+	}
+	void createPlane(float width, float height, int subdivisions, Vertex* vertices, unsigned int* indices)
+	{
+		//Rows are independent, so they are split across threads. Each row writes to a fixed offset
 		//VERTICES
-		MeshData mesh;
 		int columns = subdivisions + 1;
-		for (size_t row = 0; row <= subdivisions; row++)
-		{
-			for (size_t col = 0; col <= subdivisions; col++)
+		//Each row is emitted 8 vertices at a time
+		ew::ParallelFor(0, subdivisions + 1, minRowsPerThread(columns), [&](size_t rowBegin, size_t rowEnd) {
+			const ew::Vec3x8 normal(ew::Vec3(0, 1, 0));
+			for (size_t row = rowBegin; row < rowEnd; row++)
 			{
-				Vertex v;
-				v.uv.x = ((float)col / subdivisions);
-				v.uv.y = ((float)row / subdivisions);
-				v.pos.x = -width / 2 + width * v.uv.x;
-				v.pos.y = 0;
-				v.pos.z = height / 2 - height * v.uv.y;
-				v.normal = ew::Vec3(0, 1, 0);
-				mesh.vertices.push_back(v);
+				const float uvY = (float)row / subdivisions;
+				const ew::Float8 posZ(height / 2 - height * uvY);
+				Vertex* out = vertices + row * columns;
+				for (size_t col = 0; col < columns; col += ew::Float8::WIDTH)
+				{
+					const ew::Float8 u = ew::LaneRamp<ew::Float8>((float)col) / ew::Float8((float)subdivisions);
+					const ew::Vec3x8 pos(ew::Float8(-width / 2) + ew::Float8(width) * u, ew::Float8(0.0f), posZ);
+					ew::StoreVertices(out + col, columns - col, pos, normal, u, ew::Float8(uvY));
+				}
 			}
-		}
+		});
 		//INDICES
-		for (size_t row = 0; row < subdivisions; row++)
-		{
-			for (size_t col = 0; col < subdivisions; col++)
+		ew::ParallelFor(0, subdivisions, minRowsPerThread(subdivisions), [&](size_t rowBegin, size_t rowEnd) {
+			unsigned int* index = indices + rowBegin * subdivisions * 6;
+			for (size_t row = rowBegin; row < rowEnd; row++)
 			{
-				int start = row * columns + col;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
-				mesh.indices.push_back(start + columns + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start);
+				for (size_t col = 0; col < subdivisions; col++)
+				{
+					int start = row * columns + col;
+					*index++ = start;
+					*index++ = start + 1;
+					*index++ = start + columns + 1;
+					*index++ = start + columns + 1;
+					*index++ = start + columns;
+					*index++ = start;
+				}
 			}
-		}
-		return mesh;
+		});
 	}
 	MeshData createSphere(float radius, int subdivisions)
 	{
-		MeshData mesh;
+		MeshData mesh = AllocateMeshData(getSphereSize(subdivisions));
+		createSphere(radius, subdivisions, mesh.vertices.data(), mesh.indices.data());
+		return mesh;
+	}
+	void createSphere(float radius, int subdivisions, Vertex* vertices, unsigned int* indices)
+	{
 		//VERTICES
 		float thetaStep = ew::TAU / subdivisions;
 		float phiStep = ew::PI / subdivisions;
-		for (size_t row = 0; row <= subdivisions; row++)
-		{
-			float phi = row * phiStep;
-			for (size_t col = 0; col <= subdivisions; col++)
+		unsigned int columns = subdivisions + 1;
+		//Column angles come from a ring table shared by every row, row angles are computed once per row.
+		//Each row is emitted 8 vertices at a time
+		ew::ParallelFor(0, subdivisions + 1, minRowsPerThread(columns), [&](size_t rowBegin, size_t rowEnd) {
+			ew::RingTable ring;
+			for (size_t colBegin = 0; colBegin < columns; colBegin += ew::RingTable::CAPACITY)
 			{
-				float theta = thetaStep * col;
-				Vertex v;
-				v.normal.x = cosf(theta) * sinf(phi);
-				v.normal.y = cosf(phi);
-				v.normal.z = sinf(theta) * sinf(phi);
-				v.pos = v.normal * radius;
-				v.uv.x = (float)col / subdivisions;
-				v.uv.y = 1.0 - ((float)row / subdivisions);
-				mesh.vertices.push_back(v);
+				ring.compute(thetaStep, colBegin, columns - colBegin);
+				for (size_t row = rowBegin; row < rowEnd; row++)
+				{
+					float phi = row * phiStep;
+					const ew::Float8 sinPhi(sinf(phi));
+					const ew::Float8 cosPhi(cosf(phi));
+					const ew::Float8 uvY((float)(1.0 - ((float)row / subdivisions)));
+					Vertex* out = vertices + row * columns + colBegin;
+					for (size_t i = 0; i < ring.count; i += ew::Float8::WIDTH)
+					{
+						const ew::Vec3x8 normal(ew::Float8::Load(ring.cosA + i) * sinPhi, cosPhi, ew::Float8::Load(ring.sinA + i) * sinPhi);
+						const ew::Float8 u = ew::LaneRamp<ew::Float8>((float)(colBegin + i)) / ew::Float8((float)subdivisions);
+						ew::StoreVertices(out + i, ring.count - i, normal * ew::Float8(radius), normal, u, uvY);
+					}
+				}
 			}
-		}
+		});
 
 		//INDICES
-		unsigned int columns = subdivisions + 1;
 		unsigned int sideStart = columns;
 		unsigned int poleStart = 0;
 		//Top cap
 		for (size_t i = 0; i < subdivisions; i++)
 		{
-			mesh.indices.push_back(sideStart + i);
-			mesh.indices.push_back(poleStart + i);
-			mesh.indices.push_back(sideStart + i + 1);
+			*indices++ = sideStart + i;
+			*indices++ = poleStart + i;
+			*indices++ = sideStart + i + 1;
 		}
 		//Rows of quads for sides
-		for (size_t row = 1; row < subdivisions - 1; row++)
-		{
-			for (size_t col = 0; col < subdivisions; col++)
+		const size_t sideRows = subdivisions > 2 ? subdivisions - 2 : 0;
+		ew::ParallelFor(1, 1 + sideRows, minRowsPerThread(subdivisions), [&](size_t rowBegin, size_t rowEnd) {
+			unsigned int* index = indices + (rowBegin - 1) * subdivisions * 6;
+			for (size_t row = rowBegin; row < rowEnd; row++)
 			{
-				int start = row * columns + col;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
+				for (size_t col = 0; col < subdivisions; col++)
+				{
+					int start = row * columns + col;
+					*index++ = start;
+					*index++ = start + 1;
+					*index++ = start + columns;
+					*index++ = start + columns;
+					*index++ = start + 1;
+					*index++ = start + columns + 1;
+				}
 			}
-		}
+		});
+		indices += sideRows * subdivisions * 6;
 		//Bottom cap
 		poleStart = (columns * columns) - columns;
 		sideStart = poleStart - columns;
 		for (size_t i = 0; i < subdivisions; i++)
 		{
-			mesh.indices.push_back(sideStart + i);
-			mesh.indices.push_back(sideStart + i + 1);
-			mesh.indices.push_back(poleStart + i);
+			*indices++ = sideStart + i;
+			*indices++ = sideStart + i + 1;
+			*indices++ = poleStart + i;
 		}
-		return mesh;
 	}
-	void createCylinderRing(MeshData* meshData, float radius, int subdivisions, float y, bool sideFacing) {
-		float thetaStep = ew::TAU / subdivisions;
-		for (size_t i = 0; i <= subdivisions; i++)
+	//Writes the ring.count vertices of a cylinder ring starting at column first, 8 at a time
+	static void createCylinderRing(Vertex* vertices, const RingTable& ring, size_t first, float radius, int subdivisions, float y, bool sideFacing) {
+		for (size_t i = 0; i < ring.count; i += ew::Float8::WIDTH)
 		{
-			float theta = i * thetaStep;
-			float cosA = cosf(theta);
-			float sinA = sinf(theta);
-			ew::Vertex v;
-			v.pos = ew::Vec3(cosA * radius, y, sinA * radius);
+			const ew::Float8 cosA = ew::Float8::Load(ring.cosA + i);
+			const ew::Float8 sinA = ew::Float8::Load(ring.sinA + i);
+			const ew::Vec3x8 pos(cosA * ew::Float8(radius), ew::Float8(y), sinA * ew::Float8(radius));
 			if (sideFacing) {
-				v.normal = ew::Vec3(cosA, 0, sinA);
-				v.uv = ew::Vec2((float)i / subdivisions, y > 0 ? 1 : 0);
+				const ew::Float8 u = ew::LaneRamp<ew::Float8>((float)(first + i)) / ew::Float8((float)subdivisions);
+				ew::StoreVertices(vertices + i, ring.count - i, pos, ew::Vec3x8(cosA, ew::Float8(0.0f), sinA), u, ew::Float8(y > 0 ? 1.0f : 0.0f));
 			}
 			else {
-				v.normal = ew::Vec3(0, ew::Sign(y), 0);
-				v.uv = ew::Vec2(cosA * 0.5 + 0.5, sinA * 0.5 + 0.5);
+				const ew::Float8 half(0.5f);
+				ew::StoreVertices(vertices + i, ring.count - i, pos, ew::Vec3x8(ew::Vec3(0, ew::Sign(y), 0)), cosA * half + half, sinA * half + half);
 			}
-
-			meshData->vertices.push_back(v);
 		}
 	}
 	MeshData createCylinder(float radius, float height, int subdivisions)
 	{
-		MeshData mesh;
-
+		MeshData mesh = AllocateMeshData(getCylinderSize(subdivisions));
+		createCylinder(radius, height, subdivisions, mesh.vertices.data(), mesh.indices.data());
+		return mesh;
+	}
+	void createCylinder(float radius, float height, int subdivisions, Vertex* vertices, unsigned int* indices)
+	{
 		//VERTICES
 		{
 			const float topY = height * 0.5;
 			const float bottomY = -topY;
 
-			ew::Vertex topVertex;
-			topVertex.pos = ew::Vec3(0, topY, 0);
-			topVertex.normal = ew::Vec3(0, 1, 0);
-			topVertex.uv = ew::Vec2(0.5);
-			mesh.vertices.push_back(topVertex);
+			const size_t columns = subdivisions + 1;
+			Vertex* top = vertices;
+			Vertex* topCap = top + 1;
+			Vertex* topSide = topCap + columns;
+			Vertex* bottomSide = topSide + columns;
+			Vertex* bottomCap = bottomSide + columns;
+			Vertex* bottom = bottomCap + columns;
 
-			createCylinderRing(&mesh, radius, subdivisions, topY, false);
-			createCylinderRing(&mesh, radius, subdivisions, topY, true);
-			createCylinderRing(&mesh, radius, subdivisions, bottomY, true);
-			createCylinderRing(&mesh, radius, subdivisions, bottomY, false);
+			top->pos = ew::Vec3(0, topY, 0);
+			top->normal = ew::Vec3(0, 1, 0);
+			top->uv = ew::Vec2(0.5);
 
-			ew::Vertex bottomVertex;
-			bottomVertex.pos = ew::Vec3(0, bottomY, 0);
-			bottomVertex.normal = ew::Vec3(0, -1, 0);
-			bottomVertex.uv = ew::Vec2(0.5);
-			mesh.vertices.push_back(bottomVertex);
+			//All four rings share the same angles
+			const float thetaStep = ew::TAU / subdivisions;
+			ew::RingTable ring;
+			for (size_t first = 0; first < columns; first += ew::RingTable::CAPACITY)
+			{
+				ring.compute(thetaStep, first, columns - first);
+				createCylinderRing(topCap + first, ring, first, radius, subdivisions, topY, false);
+				createCylinderRing(topSide + first, ring, first, radius, subdivisions, topY, true);
+				createCylinderRing(bottomSide + first, ring, first, radius, subdivisions, bottomY, true);
+				createCylinderRing(bottomCap + first, ring, first, radius, subdivisions, bottomY, false);
+			}
+
+			bottom->pos = ew::Vec3(0, bottomY, 0);
+			bottom->normal = ew::Vec3(0, -1, 0);
+			bottom->uv = ew::Vec2(0.5);
 		}
 
 
@@ -206,32 +284,31 @@ namespace ew {
 			//Top cap
 			for (size_t i = 0; i < columns; i++)
 			{
-				mesh.indices.push_back(0);
-				mesh.indices.push_back(i + 1);
-				mesh.indices.push_back(i);
+				*indices++ = 0;
+				*indices++ = i + 1;
+				*indices++ = i;
 			}
 			int sideStart = columns;
 			//Sides
 			for (size_t i = 0; i < columns; i++)
 			{
 				int start = sideStart + i;
-				mesh.indices.push_back(start);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + columns);
-				mesh.indices.push_back(start + 1);
-				mesh.indices.push_back(start + columns + 1);
+				*indices++ = start;
+				*indices++ = start + 1;
+				*indices++ = start + columns;
+				*indices++ = start + columns;
+				*indices++ = start + 1;
+				*indices++ = start + columns + 1;
 			}
 			//Bottom cap
-			int bottomIndex = mesh.vertices.size() - 1;
+			int bottomIndex = getCylinderSize(subdivisions).numVertices - 1;
 			sideStart = bottomIndex - columns;
 			for (size_t i = 0; i < columns; i++)
 			{
-				mesh.indices.push_back(bottomIndex);
-				mesh.indices.push_back(sideStart + i);
-				mesh.indices.push_back(sideStart + i + 1);
+				*indices++ = bottomIndex;
+				*indices++ = sideStart + i;
+				*indices++ = sideStart + i + 1;
 			}
 		}
-		return mesh;
 	}
 }
\ No newline at end of file
@@ -11,4 +11,17 @@ namespace ew {
 	MeshData createPlane(float width, float height, int subdivisions);
 	MeshData createSphere(float radius, int subdivisions);
 	MeshData createCylinder(float radius, float height, int subdivisions);
-}
\ No newline at end of file
+
+	//Exact output sizes of the generators below
+	MeshSize getCubeSize();
+	MeshSize getPlaneSize(int subdivisions);
+	MeshSize getSphereSize(int subdivisions);
+	MeshSize getCylinderSize(int subdivisions);
+
+	//Allocation free generators. vertices and indices are caller owned and must hold at least the matching get*Size.
+	//Indices are relative to vertices[0], so offset them or draw with a base vertex when packing several meshes into one buffer
+	void createCube(float size, Vertex* vertices, unsigned int* indices);
+	void createPlane(float width, float height, int subdivisions, Vertex* vertices, unsigned int* indices);
+	void createSphere(float radius, int subdivisions, Vertex* vertices, unsigned int* indices);
+	void createCylinder(float radius, float height, int subdivisions, Vertex* vertices, unsigned int* indices);
+}
@@ -0,0 +1,122 @@
+#include "procLod.h"
+#include <limits.h>
+#include <math.h>
+#include "procGen.h"
+#include "lod.h"
+
+namespace ew {
+	//Rounds up to the next 2^k or 3 * 2^k
+	static int roundUpSegments(int segments) {
+		for (int p = 2;; p *= 2) {
+			if (segments <= p) {
+				return p;
+			}
+			if (segments <= p + p / 2) {
+				return p + p / 2;
+			}
+		}
+	}
+
+	int SegmentsForError(float radius, float maxError)
+	{
+		if (maxError <= 0.0f) {
+			return INT_MAX;
+		}
+		if (maxError >= radius) {
+			return 3;
+		}
+		const float segments = ceilf(ew::PI / acosf(1.0f - maxError / radius));
+		return segments < (float)INT_MAX ? (int)segments : INT_MAX;
+	}
+
+	int ScaleSegments(int segments, float fromRadius, float toRadius)
+	{
+		if (fromRadius <= 0.0f) {
+			return segments;
+		}
+		return (int)ceilf(segments * sqrtf(toRadius / fromRadius));
+	}
+
+	ProceduralShape proceduralSphere(float radius)
+	{
+		ProceduralShape shape;
+		shape.radius = radius;
+		shape.curvatureRadius = radius;
+		shape.generate = [radius](int segments) { return createSphere(radius, segments); };
+		return shape;
+	}
+
+	ProceduralShape proceduralCylinder(float radius, float height)
+	{
+		ProceduralShape shape;
+		shape.radius = sqrtf(radius * radius + height * height * 0.25f);
+		shape.curvatureRadius = radius;
+		shape.generate = [radius, height](int segments) { return createCylinder(radius, height, segments); };
+		return shape;
+	}
+
+	ProceduralLodCache::ProceduralLodCache(size_t maxBytes, VertexFormat vertexFormat)
+		:m_maxBytes(maxBytes), m_vertexFormat(vertexFormat)
+	{
+	}
+
+	ProceduralLodCache::~ProceduralLodCache()
+	{
+		for (Entry& entry : m_entries) {
+			entry.mesh.unload();
+		}
+	}
+
+	size_t ProceduralLodCache::addShape(const ProceduralShape& shape)
+	{
+		m_shapes.push_back(shape);
+		return m_shapes.size() - 1;
+	}
+
+	int ProceduralLodCache::selectSegments(size_t shape, const Camera& camera, const Mat4& model, float screenHeight, float maxPixelError) const
+	{
+		const ProceduralShape& s = m_shapes[shape];
+		BoundingSphere modelSphere;
+		modelSphere.radius = s.radius;
+		const BoundingSphere worldSphere = TransformSphere(modelSphere, model);
+		const float scale = s.radius > 0.0f ? worldSphere.radius / s.radius : 1.0f;
+		//Largest model space error that stays under maxPixelError on screen
+		const float pixelsPerUnit = ProjectedPixels(camera, worldSphere, scale, screenHeight);
+		const float maxError = pixelsPerUnit > 0.0f ? maxPixelError / pixelsPerUnit : s.curvatureRadius;
+		const int segments = SegmentsForError(s.curvatureRadius, maxError);
+		if (segments >= s.maxSegments) {
+			return s.maxSegments;
+		}
+		const int rounded = roundUpSegments(segments < s.minSegments ? s.minSegments : segments);
+		return rounded < s.maxSegments ? rounded : s.maxSegments;
+	}
+
+	const Mesh& ProceduralLodCache::getMesh(size_t shape, int segments)
+	{
+		const uint64_t key = ((uint64_t)shape << 32) | (uint32_t)segments;
+		auto found = m_lookup.find(key);
+		if (found != m_lookup.end()) {
+			m_entries.splice(m_entries.begin(), m_entries, found->second);
+			return m_entries.front().mesh;
+		}
+
+		const MeshData meshData = m_shapes[shape].generate(segments);
+		m_entries.emplace_front();
+		Entry& entry = m_entries.front();
+		entry.key = key;
+		entry.mesh.load(meshData, m_vertexFormat);
+		entry.bytes = entry.mesh.getNumVertices() * GetVertexSize(m_vertexFormat) + entry.mesh.getNumIndices() * sizeof(uint16_t);
+		m_lookup[key] = m_entries.begin();
+		m_usedBytes += entry.bytes;
+
+		//Never evicts the mesh just returned, even if it alone exceeds the budget
+		while (m_usedBytes > m_maxBytes && m_entries.size() > 1) {
+			Entry& oldest = m_entries.back();
+			oldest.mesh.unload();
+			m_usedBytes -= oldest.bytes;
+			m_lookup.erase(oldest.key);
+			m_entries.pop_back();
+		}
+		return m_entries.front().mesh;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "mesh.h"
+#include "camera.h"
+
+namespace ew {
+	//Smallest number of segments for which a circle of radius deviates at most maxError from its polygon: r * (1 - cos(pi / n))
+	int SegmentsForError(float radius, float maxError);
+	//Segments for a circle of toRadius with the same error as segments on a circle of fromRadius.
+	//Error falls with the square of the segment count, so this grows with the square root of the radius ratio
+	int ScaleSegments(int segments, float fromRadius, float toRadius);
+
+	//Generator that can be re-tessellated to any segment count
+	struct ProceduralShape {
+		float radius; //Bounding sphere radius, centered on the origin
+		float curvatureRadius; //Radius of the circle segments divides. Tighter circles derive their own count with ScaleSegments
+		int minSegments = 3;
+		int maxSegments = 256;
+		std::function<MeshData(int segments)> generate;
+	};
+
+	ProceduralShape proceduralSphere(float radius);
+	ProceduralShape proceduralCylinder(float radius, float height);
+
+	//Picks a segment count per object from its projected size, then generates and uploads that variant on first use.
+	//Segment counts are rounded up to 2^k or 3 * 2^k so nearby distances share meshes. Uploaded meshes are kept in
+	//least recently used order and unloaded once their total size exceeds the memory budget
+	class ProceduralLodCache {
+	public:
+		ProceduralLodCache(size_t maxBytes = 64 * 1024 * 1024, VertexFormat vertexFormat = VertexFormat::FLOAT32);
+		~ProceduralLodCache();
+		ProceduralLodCache(const ProceduralLodCache&) = delete;
+		ProceduralLodCache& operator=(const ProceduralLodCache&) = delete;
+
+		//Returns the handle to pass to the other functions
+		size_t addShape(const ProceduralShape& shape);
+		//Fewest segments whose tessellation error projects to at most maxPixelError pixels with this model matrix
+		int selectSegments(size_t shape, const Camera& camera, const Mat4& model, float screenHeight, float maxPixelError = 1.0f)const;
+		//Mesh of shape with segments, generated on a miss. May unload other meshes, so draw it before the next call
+		const Mesh& getMesh(size_t shape, int segments);
+		inline const Mesh& getMesh(size_t shape, const Camera& camera, const Mat4& model, float screenHeight, float maxPixelError = 1.0f) {
+			return getMesh(shape, selectSegments(shape, camera, model, screenHeight, maxPixelError));
+		}
+		inline const ProceduralShape& getShape(size_t shape)const { return m_shapes[shape]; }
+		//GPU memory held by cached meshes, in bytes
+		inline size_t getUsedBytes()const { return m_usedBytes; }
+		inline size_t getNumMeshes()const { return m_entries.size(); }
+
+	private:
+		struct Entry {
+			uint64_t key;
+			size_t bytes;
+			Mesh mesh;
+		};
+
+		size_t m_maxBytes;
+		VertexFormat m_vertexFormat;
+		size_t m_usedBytes = 0;
+		std::vector<ProceduralShape> m_shapes;
+		//Most recently used first
+		std::list<Entry> m_entries;
+		std::unordered_map<uint64_t, std::list<Entry>::iterator> m_lookup;
+	};
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+
+namespace ew {
+	//Sines and cosines of evenly spaced angles around a ring.
+	//Generators fill one table per block of columns and reuse it for every row or face sharing those angles,
+	//instead of calling sinf/cosf per vertex. The table lives on the stack, so rings with more than CAPACITY
+	//columns are walked in blocks
+	struct RingTable {
+		static constexpr size_t CAPACITY = 256;
+		float sinA[CAPACITY];
+		float cosA[CAPACITY];
+		size_t count;
+
+		//Angles (first + i) * step for i in [0, count), count clamped to CAPACITY.
+		//Entries are filled up to the next multiple of 8 so packet loads never read uninitialized lanes
+		inline void compute(float step, size_t first, size_t count) {
+			this->count = count < CAPACITY ? count : CAPACITY;
+			const size_t padded = (this->count + 7) & ~(size_t)7;
+			for (size_t i = 0; i < padded; i++) {
+				//Same expression the generators used per vertex, so results are unchanged
+				const float theta = (first + i) * step;
+				sinA[i] = sinf(theta);
+				cosA[i] = cosf(theta);
+			}
+		}
+	};
+}
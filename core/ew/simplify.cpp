@@ -0,0 +1,293 @@
+#include "simplify.h"
+#include <math.h>
+#include <algorithm>
+
+namespace ew {
+	namespace {
+		//Symmetric 4x4 matrix summing weighted squared distances to planes
+		struct Quadric {
+			double a2 = 0, ab = 0, ac = 0, ad = 0;
+			double b2 = 0, bc = 0, bd = 0;
+			double c2 = 0, cd = 0;
+			double d2 = 0;
+			double weight = 0;
+
+			//Plane ax + by + cz + d = 0 with a unit normal
+			void addPlane(double a, double b, double c, double d, double w) {
+				a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+				b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+				c2 += w * c * c; cd += w * c * d;
+				d2 += w * d * d;
+				weight += w;
+			}
+			Quadric& operator+=(const Quadric& q) {
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+				b2 += q.b2; bc += q.bc; bd += q.bd;
+				c2 += q.c2; cd += q.cd;
+				d2 += q.d2;
+				weight += q.weight;
+				return *this;
+			}
+			//Weighted mean squared distance from p to the planes
+			double evaluate(const Vec3& p) const {
+				if (weight <= 0.0) {
+					return 0.0;
+				}
+				const double x = p.x, y = p.y, z = p.z;
+				const double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+					+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+					+ c2 * z * z + 2 * cd * z
+					+ d2;
+				return error > 0.0 ? error / weight : 0.0;
+			}
+		};
+
+		struct Collapse {
+			unsigned int from;
+			unsigned int to;
+			double cost;
+		};
+
+		//Triangles using each vertex, as offsets into a flat array
+		struct Adjacency {
+			std::vector<unsigned int> offsets;
+			std::vector<unsigned int> triangles;
+
+			void build(const std::vector<unsigned int>& indices, size_t numVertices) {
+				offsets.assign(numVertices + 1, 0);
+				for (unsigned int v : indices) {
+					offsets[v + 1]++;
+				}
+				for (size_t v = 0; v < numVertices; v++) {
+					offsets[v + 1] += offsets[v];
+				}
+				triangles.resize(indices.size());
+				std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < indices.size(); i++) {
+					triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+				}
+			}
+			inline const unsigned int* begin(unsigned int v) const { return triangles.data() + offsets[v]; }
+			inline const unsigned int* end(unsigned int v) const { return triangles.data() + offsets[v + 1]; }
+		};
+
+		//Whether any triangle around vertex has the directed edge a -> b
+		bool hasEdge(const std::vector<unsigned int>& indices, const Adjacency& adjacency, unsigned int vertex, unsigned int a, unsigned int b) {
+			for (const unsigned int* t = adjacency.begin(vertex); t != adjacency.end(vertex); t++) {
+				const unsigned int* tri = &indices[*t * 3];
+				for (int k = 0; k < 3; k++) {
+					if (tri[k] == a && tri[(k + 1) % 3] == b) {
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+
+		//Collapsing from onto to must not leave an edge shared by more than two triangles.
+		//Holds when the only vertices adjacent to both are the third vertices of triangles containing the edge
+		bool keepsManifold(const std::vector<unsigned int>& indices, const Adjacency& adjacency, unsigned int from, unsigned int to, std::vector<unsigned int>& scratch) {
+			scratch.clear();
+			size_t sharedTriangles = 0;
+			for (const unsigned int* t = adjacency.begin(from); t != adjacency.end(from); t++) {
+				const unsigned int* tri = &indices[*t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to) {
+					sharedTriangles++;
+				}
+				for (int k = 0; k < 3; k++) {
+					if (tri[k] != from && tri[k] != to) {
+						scratch.push_back(tri[k]);
+					}
+				}
+			}
+			std::sort(scratch.begin(), scratch.end());
+			scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+			size_t common = 0;
+			for (unsigned int neighbor : scratch) {
+				if (hasEdge(indices, adjacency, neighbor, neighbor, to) || hasEdge(indices, adjacency, neighbor, to, neighbor)) {
+					common++;
+				}
+			}
+			return common <= sharedTriangles;
+		}
+
+		//Moving from onto to must not turn any remaining triangle by more than about 75 degrees, which would fold the surface
+		bool flipsTriangle(const std::vector<unsigned int>& indices, const Adjacency& adjacency, const Vertex* vertices, unsigned int from, unsigned int to) {
+			const Vec3& target = vertices[to].pos;
+			for (const unsigned int* t = adjacency.begin(from); t != adjacency.end(from); t++) {
+				const unsigned int* tri = &indices[*t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to) {
+					continue;
+				}
+				const Vec3& p0 = vertices[tri[0]].pos;
+				const Vec3& p1 = vertices[tri[1]].pos;
+				const Vec3& p2 = vertices[tri[2]].pos;
+				const Vec3 before = Cross(p1 - p0, p2 - p0);
+				const Vec3& q0 = tri[0] == from ? target : p0;
+				const Vec3& q1 = tri[1] == from ? target : p1;
+				const Vec3& q2 = tri[2] == from ? target : p2;
+				const Vec3 after = Cross(q1 - q0, q2 - q0);
+				if (Dot(before, after) <= 0.25f * Magnitude(before) * Magnitude(after)) {
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+
+	MeshData simplifyMesh(const MeshData& meshData, size_t targetIndexCount, float maxError, float* resultError)
+	{
+		const Vertex* vertices = meshData.vertices.data();
+		const size_t numVertices = meshData.vertices.size();
+		std::vector<unsigned int> indices(meshData.indices.begin(), meshData.indices.begin() + meshData.indices.size() / 3 * 3);
+		const size_t targetTriangles = targetIndexCount / 3;
+		const double maxCost = maxError < FLT_MAX ? (double)maxError * maxError : DBL_MAX;
+
+		Adjacency adjacency;
+		adjacency.build(indices, numVertices);
+
+		//Vertices with an edge no other triangle shares in reverse are on a border or a seam
+		std::vector<char> locked(numVertices, 0);
+		std::vector<Quadric> quadrics(numVertices);
+		for (size_t t = 0; t < indices.size() / 3; t++) {
+			const unsigned int* tri = &indices[t * 3];
+			for (int k = 0; k < 3; k++) {
+				const unsigned int a = tri[k];
+				const unsigned int b = tri[(k + 1) % 3];
+				if (!hasEdge(indices, adjacency, b, b, a)) {
+					locked[a] = locked[b] = 1;
+				}
+			}
+			const Vec3& p0 = vertices[tri[0]].pos;
+			const Vec3 normal = Cross(vertices[tri[1]].pos - p0, vertices[tri[2]].pos - p0);
+			const float length = Magnitude(normal);
+			if (length > 0.0f) {
+				const Vec3 n = normal / length;
+				Quadric plane;
+				//Weighted by area, so the error does not depend on how finely the surface is tessellated
+				plane.addPlane(n.x, n.y, n.z, -Dot(n, p0), length * 0.5f);
+				for (int k = 0; k < 3; k++) {
+					quadrics[tri[k]] += plane;
+				}
+			}
+		}
+
+		double error = 0.0;
+		std::vector<Collapse> collapses;
+		std::vector<unsigned int> remap(numVertices);
+		std::vector<char> touched(numVertices);
+		std::vector<unsigned int> scratch;
+		//Each pass collapses a set of edges whose neighborhoods do not overlap, cheapest first
+		while (indices.size() / 3 > targetTriangles) {
+			collapses.clear();
+			for (size_t t = 0; t < indices.size() / 3; t++) {
+				const unsigned int* tri = &indices[t * 3];
+				for (int k = 0; k < 3; k++) {
+					//Each interior edge appears once in each direction
+					const unsigned int from = tri[k];
+					const unsigned int to = tri[(k + 1) % 3];
+					if (locked[from]) {
+						continue;
+					}
+					Quadric q = quadrics[from];
+					q += quadrics[to];
+					const double cost = q.evaluate(vertices[to].pos);
+					if (cost <= maxCost) {
+						collapses.push_back({ from, to, cost });
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			for (size_t v = 0; v < numVertices; v++) {
+				remap[v] = (unsigned int)v;
+			}
+			std::fill(touched.begin(), touched.end(), 0);
+			size_t numTriangles = indices.size() / 3;
+			size_t numCollapsed = 0;
+			for (const Collapse& collapse : collapses) {
+				if (numTriangles <= targetTriangles) {
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to]) {
+					continue;
+				}
+				if (flipsTriangle(indices, adjacency, vertices, collapse.from, collapse.to)
+					|| !keepsManifold(indices, adjacency, collapse.from, collapse.to, scratch)) {
+					continue;
+				}
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to] += quadrics[collapse.from];
+				error = std::max(error, collapse.cost);
+				for (const unsigned int* t = adjacency.begin(collapse.from); t != adjacency.end(collapse.from); t++) {
+					const unsigned int* tri = &indices[*t * 3];
+					if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+						numTriangles--;
+					}
+					touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+				}
+				numCollapsed++;
+			}
+			if (numCollapsed == 0) {
+				break;
+			}
+
+			size_t write = 0;
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				const unsigned int a = remap[indices[i]];
+				const unsigned int b = remap[indices[i + 1]];
+				const unsigned int c = remap[indices[i + 2]];
+				if (a != b && b != c && a != c) {
+					indices[write++] = a;
+					indices[write++] = b;
+					indices[write++] = c;
+				}
+			}
+			indices.resize(write);
+			adjacency.build(indices, numVertices);
+		}
+
+		//Keep only referenced vertices, in first use order
+		const unsigned int UNASSIGNED = ~0u;
+		std::vector<unsigned int> compact(numVertices, UNASSIGNED);
+		MeshData result;
+		result.indices.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); i++) {
+			unsigned int& index = compact[indices[i]];
+			if (index == UNASSIGNED) {
+				index = (unsigned int)result.vertices.size();
+				result.vertices.push_back(vertices[indices[i]]);
+			}
+			result.indices[i] = index;
+		}
+		if (resultError) {
+			*resultError = (float)sqrt(error);
+		}
+		return result;
+	}
+
+	LodChain generateLodChain(const MeshData& meshData, const LodSettings& settings)
+	{
+		const float maxError = settings.maxError * ComputeBoundingSphere(meshData).radius;
+		LodChain chain;
+		chain.levels.push_back(meshData);
+		chain.errors.push_back(0.0f);
+		while (chain.levels.size() < settings.maxLevels) {
+			const MeshData& previous = chain.levels.back();
+			const size_t previousTriangles = previous.indices.size() / 3;
+			const size_t targetTriangles = std::max((size_t)(previousTriangles * settings.reduction), settings.minTriangles);
+			if (targetTriangles >= previousTriangles) {
+				break;
+			}
+			float levelError = 0.0f;
+			MeshData level = simplifyMesh(previous, targetTriangles * 3, maxError, &levelError);
+			if (level.indices.size() / 3 > previousTriangles - previousTriangles / 10) {
+				break;
+			}
+			//Error estimates of successive levels add up to an estimate of the distance from full detail
+			chain.errors.push_back(chain.errors.back() + levelError);
+			chain.levels.push_back(std::move(level));
+		}
+		return chain;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <float.h>
+#include <stddef.h>
+#include <vector>
+#include "mesh.h"
+
+namespace ew {
+	//Reduces meshData to at most targetIndexCount indices with quadric error metric edge collapses (Garland and Heckbert),
+	//stopping early once a collapse's error estimate exceeds maxError model space units. A collapse's error estimate is the
+	//root of the area weighted mean squared distance from the new vertex to the planes of the triangles it replaces,
+	//so parts of the surface can move further than it.
+	//Vertices are only ever collapsed onto a neighbor, so uvs and normals are never interpolated. Vertices on an open edge
+	//never move, which keeps uv seams, hard edges and borders intact since those are all split vertices.
+	//Unreferenced vertices are removed. resultError, if not null, receives the largest error estimate of any collapse
+	MeshData simplifyMesh(const MeshData& meshData, size_t targetIndexCount, float maxError = FLT_MAX, float* resultError = nullptr);
+
+	struct LodSettings {
+		size_t maxLevels = 4; //Including the full detail level
+		float reduction = 0.5f; //Target triangle count of each level relative to the one before
+		size_t minTriangles = 32; //No level is simplified below this
+		float maxError = 0.05f; //Per level, relative to the bounding sphere radius. Coarser levels would visibly lose the silhouette
+	};
+
+	//Full detail mesh first. errors[i] estimates how far level i's surface is from level 0's, in model space units.
+	//It is the sum of each level's largest collapse error estimate, not a bound
+	struct LodChain {
+		std::vector<MeshData> levels;
+		std::vector<float> errors;
+	};
+
+	//Each level is simplified from the one before it. Stops early once a level would not remove at least a tenth of the triangles
+	LodChain generateLodChain(const MeshData& meshData, const LodSettings& settings = LodSettings());
+}
@@ -0,0 +1,264 @@
+#include "staticBatch.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include "parallel.h"
+
+namespace ew {
+	static const size_t MIN_VERTICES_PER_THREAD = DEFAULT_MIN_CHUNK;
+
+	static void transformVertexRange(const Vertex* vertices, const Mat4& model, const Mat3& normalMatrix, Vertex* out, size_t begin, size_t end) {
+		const size_t WIDTH = Float8::WIDTH;
+		const Vec3x8 c0(model[0].toVec3()), c1(model[1].toVec3()), c2(model[2].toVec3()), c3(model[3].toVec3());
+		const Vec3x8 n0(normalMatrix[0]), n1(normalMatrix[1]), n2(normalMatrix[2]);
+		//Partial packets are read from a copy, so gathers never run past the end
+		Vertex tail[WIDTH] = {};
+		for (size_t i = begin; i < end; i += WIDTH) {
+			const size_t count = end - i < WIDTH ? end - i : WIDTH;
+			const Vertex* src = vertices + i;
+			if (count < WIDTH) {
+				memcpy(tail, src, sizeof(Vertex) * count);
+				src = tail;
+			}
+			const Vec3x8 p = Vec3x8::Gather(&src[0].pos, sizeof(Vertex));
+			const Vec3x8 n = Vec3x8::Gather(&src[0].normal, sizeof(Vertex));
+			float us[WIDTH], vs[WIDTH];
+			for (size_t k = 0; k < WIDTH; k++) {
+				us[k] = src[k].uv.x;
+				vs[k] = src[k].uv.y;
+			}
+			const Vec3x8 pos = Madd(c0, p.x, Madd(c1, p.y, Madd(c2, p.z, c3)));
+			const Vec3x8 normal = Normalize(Madd(n0, n.x, Madd(n1, n.y, n2 * n.z)));
+			StoreVertices(out + i, count, pos, normal, Float8::Load(us), Float8::Load(vs));
+		}
+	}
+
+	void TransformVertices(const Vertex* vertices, size_t numVertices, const Mat4& model, Vertex* out)
+	{
+		const Mat3 normalMatrix = NormalMatrix(model);
+		ParallelFor(0, numVertices, MIN_VERTICES_PER_THREAD, [&](size_t begin, size_t end) {
+			transformVertexRange(vertices, model, normalMatrix, out, begin, end);
+		});
+	}
+
+	void StaticBatcher::add(const MeshData& meshData, const Mat4& model, int material)
+	{
+		Source source;
+		source.meshData = &meshData;
+		source.model = model;
+		source.material = material;
+		m_sources.push_back(source);
+	}
+
+	void StaticBatcher::clear()
+	{
+		m_sources.clear();
+	}
+
+	std::vector<StaticBatch> StaticBatcher::build(size_t maxVertices) const
+	{
+		std::vector<StaticBatch> batches;
+		//Batch still being filled for each material
+		std::unordered_map<int, size_t> openBatch;
+		for (const Source& source : m_sources) {
+			const MeshData& meshData = *source.meshData;
+			auto found = openBatch.find(source.material);
+			if (found == openBatch.end() || batches[found->second].meshData.vertices.size() + meshData.vertices.size() > maxVertices) {
+				StaticBatch batch;
+				batch.material = source.material;
+				batches.push_back(batch);
+				openBatch[source.material] = batches.size() - 1;
+			}
+			StaticBatch& batch = batches[openBatch[source.material]];
+
+			BatchRange range;
+			range.firstVertex = batch.meshData.vertices.size();
+			range.numVertices = meshData.vertices.size();
+			range.firstIndex = batch.meshData.indices.size();
+			range.numIndices = meshData.indices.size();
+			batch.meshData.vertices.resize(range.firstVertex + range.numVertices);
+			Vertex* vertices = batch.meshData.vertices.data() + range.firstVertex;
+			TransformVertices(meshData.vertices.data(), range.numVertices, source.model, vertices);
+
+			//Mirroring transforms turn triangles inside out, so their winding is flipped back
+			const Vec3 c0 = source.model[0].toVec3();
+			const bool mirrored = Dot(c0, Cross(source.model[1].toVec3(), source.model[2].toVec3())) < 0.0f;
+			batch.meshData.indices.resize(range.firstIndex + range.numIndices);
+			unsigned int* indices = batch.meshData.indices.data() + range.firstIndex;
+			const unsigned int base = (unsigned int)range.firstVertex;
+			for (size_t i = 0; i + 2 < range.numIndices; i += 3) {
+				indices[i] = meshData.indices[i] + base;
+				indices[i + 1] = meshData.indices[mirrored ? i + 2 : i + 1] + base;
+				indices[i + 2] = meshData.indices[mirrored ? i + 1 : i + 2] + base;
+			}
+
+			range.bounds = ComputeBounds(vertices, range.numVertices);
+			range.boundingSphere = ComputeBoundingSphere(vertices, range.numVertices);
+			batch.ranges.push_back(range);
+		}
+		return batches;
+	}
+
+	void DrawVisibleRanges(const Mesh& mesh, const StaticBatch& batch, const Frustum& frustum, CullStats* stats)
+	{
+		//Ranges are only addressable while the batch loaded as one submesh
+		if (mesh.getSubmeshes().size() != 1) {
+			mesh.draw();
+			return;
+		}
+		const size_t count = batch.ranges.size();
+		std::vector<AABB> bounds(count);
+		for (size_t i = 0; i < count; i++) {
+			bounds[i] = batch.ranges[i].bounds;
+		}
+		std::vector<unsigned char> visible(count);
+		CullAABBs(frustum, bounds.data(), count, visible.data(), stats);
+		size_t i = 0;
+		while (i < count) {
+			if (!visible[i]) {
+				i++;
+				continue;
+			}
+			const size_t firstIndex = batch.ranges[i].firstIndex;
+			size_t numIndices = 0;
+			for (; i < count && visible[i]; i++) {
+				numIndices += batch.ranges[i].numIndices;
+			}
+			mesh.drawRange(firstIndex, numIndices);
+		}
+	}
+
+	namespace {
+		const char MAGIC[4] = { 'E', 'W', 'S', 'B' };
+		const uint32_t VERSION = 1;
+
+		struct FileHeader {
+			char magic[4];
+			uint32_t version;
+			uint32_t vertexSize;
+			uint32_t numBatches;
+		};
+		struct BatchHeader {
+			int32_t material;
+			uint32_t numRanges;
+			uint64_t numVertices;
+			uint64_t numIndices;
+		};
+		//BatchRange with fixed size fields
+		struct FileRange {
+			uint64_t firstIndex;
+			uint64_t numIndices;
+			uint64_t firstVertex;
+			uint64_t numVertices;
+			float bounds[6];
+			float boundingSphere[4];
+		};
+	}
+
+	bool SaveStaticBatches(const std::string& filePath, const std::vector<StaticBatch>& batches)
+	{
+		FILE* file = fopen(filePath.c_str(), "wb");
+		if (file == NULL) {
+			printf("Failed to write static batches %s\n", filePath.c_str());
+			return false;
+		}
+		FileHeader header;
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.vertexSize = sizeof(Vertex);
+		header.numBatches = (uint32_t)batches.size();
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		for (const StaticBatch& batch : batches) {
+			BatchHeader batchHeader;
+			batchHeader.material = batch.material;
+			batchHeader.numRanges = (uint32_t)batch.ranges.size();
+			batchHeader.numVertices = batch.meshData.vertices.size();
+			batchHeader.numIndices = batch.meshData.indices.size();
+			ok = ok && fwrite(&batchHeader, sizeof(batchHeader), 1, file) == 1;
+			ok = ok && fwrite(batch.meshData.vertices.data(), sizeof(Vertex), batch.meshData.vertices.size(), file) == batch.meshData.vertices.size();
+			ok = ok && fwrite(batch.meshData.indices.data(), sizeof(unsigned int), batch.meshData.indices.size(), file) == batch.meshData.indices.size();
+			for (const BatchRange& range : batch.ranges) {
+				const FileRange fileRange = {
+					range.firstIndex, range.numIndices, range.firstVertex, range.numVertices,
+					{ range.bounds.min.x, range.bounds.min.y, range.bounds.min.z, range.bounds.max.x, range.bounds.max.y, range.bounds.max.z },
+					{ range.boundingSphere.center.x, range.boundingSphere.center.y, range.boundingSphere.center.z, range.boundingSphere.radius }
+				};
+				ok = ok && fwrite(&fileRange, sizeof(fileRange), 1, file) == 1;
+			}
+		}
+		ok = fclose(file) == 0 && ok;
+		if (!ok) {
+			remove(filePath.c_str());
+			printf("Failed to write static batches %s\n", filePath.c_str());
+		}
+		return ok;
+	}
+
+	bool LoadStaticBatches(const std::string& filePath, std::vector<StaticBatch>* batches)
+	{
+		FILE* file = fopen(filePath.c_str(), "rb");
+		if (file == NULL) {
+			return false;
+		}
+		fseek(file, 0, SEEK_END);
+		const long fileSize = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		FileHeader header;
+		bool ok = fread(&header, sizeof(header), 1, file) == 1
+			&& memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+			&& header.version == VERSION
+			&& header.vertexSize == sizeof(Vertex);
+		batches->clear();
+		for (uint32_t b = 0; ok && b < header.numBatches; b++) {
+			BatchHeader batchHeader;
+			if (fread(&batchHeader, sizeof(batchHeader), 1, file) != 1) {
+				ok = false;
+				break;
+			}
+			//Reject counts larger than the rest of the file before allocating for them
+			const uint64_t remaining = (uint64_t)(fileSize - ftell(file));
+			if (batchHeader.numVertices > remaining / sizeof(Vertex)
+				|| batchHeader.numIndices > (remaining - batchHeader.numVertices * sizeof(Vertex)) / sizeof(unsigned int)) {
+				ok = false;
+				break;
+			}
+			StaticBatch batch;
+			batch.material = batchHeader.material;
+			batch.meshData.vertices.resize((size_t)batchHeader.numVertices);
+			batch.meshData.indices.resize((size_t)batchHeader.numIndices);
+			ok = fread(batch.meshData.vertices.data(), sizeof(Vertex), batch.meshData.vertices.size(), file) == batch.meshData.vertices.size()
+				&& fread(batch.meshData.indices.data(), sizeof(unsigned int), batch.meshData.indices.size(), file) == batch.meshData.indices.size();
+			//Indices and ranges are used unchecked to draw, so a corrupted or edited file is rejected here
+			for (size_t i = 0; ok && i < batch.meshData.indices.size(); i++) {
+				ok = batch.meshData.indices[i] < batchHeader.numVertices;
+			}
+			for (uint32_t r = 0; ok && r < batchHeader.numRanges; r++) {
+				FileRange fileRange;
+				if (fread(&fileRange, sizeof(fileRange), 1, file) != 1
+					|| fileRange.numIndices > batchHeader.numIndices || fileRange.firstIndex > batchHeader.numIndices - fileRange.numIndices
+					|| fileRange.numVertices > batchHeader.numVertices || fileRange.firstVertex > batchHeader.numVertices - fileRange.numVertices) {
+					ok = false;
+					break;
+				}
+				BatchRange range;
+				range.firstIndex = (size_t)fileRange.firstIndex;
+				range.numIndices = (size_t)fileRange.numIndices;
+				range.firstVertex = (size_t)fileRange.firstVertex;
+				range.numVertices = (size_t)fileRange.numVertices;
+				range.bounds.min = Vec3(fileRange.bounds[0], fileRange.bounds[1], fileRange.bounds[2]);
+				range.bounds.max = Vec3(fileRange.bounds[3], fileRange.bounds[4], fileRange.bounds[5]);
+				range.boundingSphere.center = Vec3(fileRange.boundingSphere[0], fileRange.boundingSphere[1], fileRange.boundingSphere[2]);
+				range.boundingSphere.radius = fileRange.boundingSphere[3];
+				batch.ranges.push_back(range);
+			}
+			batches->push_back(batch);
+		}
+		fclose(file);
+		if (!ok) {
+			batches->clear();
+			printf("Failed to read static batches %s\n", filePath.c_str());
+		}
+		return ok;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "mesh.h"
+#include "transform.h"
+#include "culling.h"
+
+namespace ew {
+	//Writes vertices transformed by model to out: positions by model, normals by its normal matrix and renormalized.
+	//out may be vertices. Runs 8 vertices at a time, split across threads for large meshes
+	void TransformVertices(const Vertex* vertices, size_t numVertices, const Mat4& model, Vertex* out);
+
+	//Part of a static batch that came from one source object
+	struct BatchRange {
+		size_t firstIndex;
+		size_t numIndices;
+		size_t firstVertex;
+		size_t numVertices;
+		//World space, for culling the object on its own
+		AABB bounds;
+		BoundingSphere boundingSphere;
+	};
+
+	//Objects sharing a material, transformed into world space and merged into one mesh
+	struct StaticBatch {
+		int material;
+		MeshData meshData;
+		std::vector<BatchRange> ranges; //In the order the objects were added
+	};
+
+	//Merges objects that never move into one mesh per material, so they are drawn without per object uniforms.
+	//Batches are kept under maxVertices so each loads as a single 16 bit submesh
+	class StaticBatcher {
+	public:
+		//meshData is not copied and must stay alive until build()
+		void add(const MeshData& meshData, const Mat4& model, int material = 0);
+		inline void add(const MeshData& meshData, const Transform& transform, int material = 0) {
+			add(meshData, transform.getModelMatrix(), material);
+		}
+		//Batches in the order their materials were first added. A material whose objects exceed maxVertices
+		//gets several batches. An object that alone exceeds it gets a batch to itself
+		std::vector<StaticBatch> build(size_t maxVertices = MAX_16BIT_VERTICES)const;
+		void clear();
+		inline size_t getNumSources()const { return m_sources.size(); }
+
+	private:
+		struct Source {
+			const MeshData* meshData;
+			Mat4 model;
+			int material;
+		};
+		std::vector<Source> m_sources;
+	};
+
+	//Draws the ranges of batch that pass the frustum test, merging neighboring visible ranges into one draw.
+	//mesh must have been loaded from batch.meshData
+	void DrawVisibleRanges(const Mesh& mesh, const StaticBatch& batch, const Frustum& frustum, CullStats* stats = nullptr);
+
+	//Build time mode for static levels: bake batches once, e.g. from a level tool or on first launch,
+	//then load them later without transforming or merging anything. Return false if the file can't be written or read.
+	//Loading also fails on an index or range past the end of its batch
+	bool SaveStaticBatches(const std::string& filePath, const std::vector<StaticBatch>& batches);
+	bool LoadStaticBatches(const std::string& filePath, std::vector<StaticBatch>* batches);
+}
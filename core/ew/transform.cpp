@@ -0,0 +1,64 @@
+#include "transform.h"
+#include "parallel.h"
+#include "ewMath/fastTrig.h"
+
+namespace ew {
+	//Below DEFAULT_MIN_CHUNK because building a matrix costs several times a vertex
+	static const size_t MIN_MATRICES_PER_THREAD = 4096;
+	//Angles are converted in blocks so the vectorized trig loop stays separate from the matrix stores
+	static const size_t BLOCK_SIZE = 64;
+
+	static void buildModelMatrixRange(const TransformArrays& transforms, ew::Mat4* out, size_t begin, size_t end) {
+		const size_t WIDTH = ew::Float8::WIDTH;
+		ew::Vec3 sinR[BLOCK_SIZE];
+		ew::Vec3 cosR[BLOCK_SIZE];
+		for (size_t blockStart = begin; blockStart < end; blockStart += BLOCK_SIZE) {
+			const size_t blockCount = end - blockStart < BLOCK_SIZE ? end - blockStart : BLOCK_SIZE;
+			const ew::Vec3* rotations = transforms.rotations + blockStart;
+			//Sines and cosines of 8 transforms' Euler angles at a time
+			size_t i = 0;
+			for (; i + WIDTH <= blockCount; i += WIDTH) {
+				const ew::Vec3x8 r = ew::Vec3x8::Gather(rotations + i) * ew::Float8(ew::DEG2RAD);
+				ew::Vec3x8 s, c;
+				ew::FastSinCos(r.x, &s.x, &c.x);
+				ew::FastSinCos(r.y, &s.y, &c.y);
+				ew::FastSinCos(r.z, &s.z, &c.z);
+				s.scatter(sinR + i);
+				c.scatter(cosR + i);
+			}
+			for (; i < blockCount; i++) {
+				const ew::Vec3 r = rotations[i] * ew::DEG2RAD;
+				ew::FastSinCos(r.x, &sinR[i].x, &cosR[i].x);
+				ew::FastSinCos(r.y, &sinR[i].y, &cosR[i].y);
+				ew::FastSinCos(r.z, &sinR[i].z, &cosR[i].z);
+			}
+			for (i = 0; i < blockCount; i++) {
+				const size_t index = blockStart + i;
+				out[index] = ew::TRS(transforms.positions[index], sinR[i], cosR[i], transforms.scales[index]);
+			}
+		}
+	}
+
+	void BuildModelMatrices(const TransformArrays& transforms, ew::Mat4* out, bool multithreaded) {
+		if (!multithreaded) {
+			buildModelMatrixRange(transforms, out, 0, transforms.count);
+			return;
+		}
+		ew::ParallelFor(0, transforms.count, MIN_MATRICES_PER_THREAD, [&](size_t begin, size_t end) {
+			buildModelMatrixRange(transforms, out, begin, end);
+		});
+	}
+
+	void BuildModelMatrices(const Transform* transforms, size_t count, ew::Mat4* out, bool multithreaded) {
+		auto buildRange = [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				out[i] = transforms[i].getModelMatrix();
+			}
+		};
+		if (!multithreaded) {
+			buildRange(0, count);
+			return;
+		}
+		ew::ParallelFor(0, count, MIN_MATRICES_PER_THREAD, buildRange);
+	}
+}
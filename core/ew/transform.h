@@ -7,12 +7,41 @@ namespace ew {
 		ew::Vec3 rotation = ew::Vec3(0.0f, 0.0f, 0.0f); //Euler angles (Degrees)
 		ew::Vec3 scale = ew::Vec3(1.0f, 1.0f, 1.0f);
 
+		//Translate * RotateY * RotateX * RotateZ * Scale
 		ew::Mat4 getModelMatrix() const {
-			return ew::Translate(position)
-				* ew::RotateY(ew::Radians(rotation.y))
-				* ew::RotateX(ew::Radians(rotation.x))
-				* ew::RotateZ(ew::Radians(rotation.z))
-				* ew::Scale(scale);
+			return ew::TRS(position, rotation * ew::DEG2RAD, scale);
 		}
 	};
+
+	//Transform that stores orientation as a quaternion. Building the model matrix needs no trig,
+	//and orientations can be composed and interpolated directly.
+	struct QuatTransform {
+		ew::Vec3 position = ew::Vec3(0.0f, 0.0f, 0.0f);
+		ew::Quat rotation = ew::Quat();
+		ew::Vec3 scale = ew::Vec3(1.0f, 1.0f, 1.0f);
+
+		ew::Mat4 getModelMatrix() const {
+			return ew::TRS(position, rotation, scale);
+		}
+		//Euler angles (Degrees), in the same convention as Transform::rotation. Useful for editors
+		ew::Vec3 getEulerAngles() const {
+			return ew::ToEuler(rotation) * ew::RAD2DEG;
+		}
+		void setEulerAngles(const ew::Vec3& degrees) {
+			rotation = ew::QuatFromEuler(degrees * ew::DEG2RAD);
+		}
+	};
+
+	//Structure-of-arrays view over many transforms. Each array holds count elements.
+	struct TransformArrays {
+		const ew::Vec3* positions = nullptr;
+		const ew::Vec3* rotations = nullptr; //Euler angles (Degrees)
+		const ew::Vec3* scales = nullptr;
+		size_t count = 0;
+	};
+
+	//Writes transforms.count model matrices into out, matching Transform::getModelMatrix.
+	//Large batches are split across worker threads when multithreaded is true.
+	void BuildModelMatrices(const TransformArrays& transforms, ew::Mat4* out, bool multithreaded = true);
+	void BuildModelMatrices(const Transform* transforms, size_t count, ew::Mat4* out, bool multithreaded = true);
 }
@@ -0,0 +1,121 @@
+#include "vertexFormat.h"
+#include "mesh.h"
+#include "parallel.h"
+#include "shader.h"
+
+namespace ew {
+	static const size_t MIN_VERTICES_PER_THREAD = DEFAULT_MIN_CHUNK;
+
+	size_t GetVertexSize(VertexFormat format)
+	{
+		switch (format) {
+		case VertexFormat::HALF:
+			return sizeof(VertexHalf);
+		case VertexFormat::SNORM16:
+			return sizeof(VertexSnorm16);
+		case VertexFormat::COMPACT:
+			return sizeof(VertexCompact);
+		default:
+			return sizeof(Vertex);
+		}
+	}
+
+	VertexQuantization ComputeVertexQuantization(VertexFormat format, const Vertex* vertices, size_t numVertices)
+	{
+		VertexQuantization quantization;
+		if (format != VertexFormat::SNORM16 && format != VertexFormat::COMPACT) {
+			return quantization;
+		}
+		const AABB bounds = ComputeBounds(vertices, numVertices);
+		quantization.positionOffset = bounds.center();
+		quantization.positionScale = bounds.extents();
+		if (numVertices > 0) {
+			ew::Vec2 uvMin = vertices[0].uv;
+			ew::Vec2 uvMax = vertices[0].uv;
+			for (size_t i = 1; i < numVertices; i++) {
+				const ew::Vec2& uv = vertices[i].uv;
+				uvMin = ew::Vec2(fminf(uvMin.x, uv.x), fminf(uvMin.y, uv.y));
+				uvMax = ew::Vec2(fmaxf(uvMax.x, uv.x), fmaxf(uvMax.y, uv.y));
+			}
+			quantization.uvOffset = uvMin;
+			quantization.uvScale = uvMax - uvMin;
+		}
+		return quantization;
+	}
+
+	void SetQuantizationUniforms(const Shader& shader, const VertexQuantization& quantization)
+	{
+		shader.setVec3("_PositionOffset", quantization.positionOffset);
+		shader.setVec3("_PositionScale", quantization.positionScale);
+		shader.setVec2("_UVOffset", quantization.uvOffset);
+		shader.setVec2("_UVScale", quantization.uvScale);
+	}
+
+	//Reciprocal of a quantization scale. Flat axes encode as 0 and decode to the offset
+	static float inverseScale(float scale) {
+		return scale > 0.0f ? 1.0f / scale : 0.0f;
+	}
+
+	void EncodeVertices(VertexFormat format, const Vertex* vertices, size_t numVertices, const VertexQuantization& quantization, void* out)
+	{
+		if (format == VertexFormat::FLOAT32) {
+			memcpy(out, vertices, numVertices * sizeof(Vertex));
+			return;
+		}
+		const ew::Vec3 invPositionScale(inverseScale(quantization.positionScale.x), inverseScale(quantization.positionScale.y), inverseScale(quantization.positionScale.z));
+		const ew::Vec2 invUVScale(inverseScale(quantization.uvScale.x), inverseScale(quantization.uvScale.y));
+		ParallelFor(0, numVertices, MIN_VERTICES_PER_THREAD, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const Vertex& v = vertices[i];
+				const ew::Vec3 pos = v.pos - quantization.positionOffset;
+				const ew::Vec3 q(pos.x * invPositionScale.x, pos.y * invPositionScale.y, pos.z * invPositionScale.z);
+				const ew::Vec2 uv((v.uv.x - quantization.uvOffset.x) * invUVScale.x, (v.uv.y - quantization.uvOffset.y) * invUVScale.y);
+				const ew::Vec2 normal = OctEncode(v.normal);
+				switch (format) {
+				case VertexFormat::HALF: {
+					VertexHalf& o = static_cast<VertexHalf*>(out)[i];
+					o.pos[0] = FloatToHalf(q.x);
+					o.pos[1] = FloatToHalf(q.y);
+					o.pos[2] = FloatToHalf(q.z);
+					o.padding = 0;
+					o.normal[0] = (int16_t)QuantizeSnorm(normal.x, 32767);
+					o.normal[1] = (int16_t)QuantizeSnorm(normal.y, 32767);
+					o.uv[0] = FloatToHalf(uv.x);
+					o.uv[1] = FloatToHalf(uv.y);
+					break;
+				}
+				case VertexFormat::SNORM16: {
+					VertexSnorm16& o = static_cast<VertexSnorm16*>(out)[i];
+					o.pos[0] = (int16_t)QuantizeSnorm(q.x, 32767);
+					o.pos[1] = (int16_t)QuantizeSnorm(q.y, 32767);
+					o.pos[2] = (int16_t)QuantizeSnorm(q.z, 32767);
+					o.padding = 0;
+					o.normal[0] = (int16_t)QuantizeSnorm(normal.x, 32767);
+					o.normal[1] = (int16_t)QuantizeSnorm(normal.y, 32767);
+					o.uv[0] = (uint16_t)QuantizeUnorm(uv.x, 65535);
+					o.uv[1] = (uint16_t)QuantizeUnorm(uv.y, 65535);
+					break;
+				}
+				default: {
+					VertexCompact& o = static_cast<VertexCompact*>(out)[i];
+					o.pos[0] = (int16_t)QuantizeSnorm(q.x, 32767);
+					o.pos[1] = (int16_t)QuantizeSnorm(q.y, 32767);
+					o.pos[2] = (int16_t)QuantizeSnorm(q.z, 32767);
+					o.normal[0] = (int8_t)QuantizeSnorm(normal.x, 127);
+					o.normal[1] = (int8_t)QuantizeSnorm(normal.y, 127);
+					o.uv[0] = (uint16_t)QuantizeUnorm(uv.x, 65535);
+					o.uv[1] = (uint16_t)QuantizeUnorm(uv.y, 65535);
+					break;
+				}
+				}
+			}
+		});
+	}
+
+	std::vector<unsigned char> EncodeVertices(VertexFormat format, const MeshData& meshData, const VertexQuantization& quantization)
+	{
+		std::vector<unsigned char> encoded(meshData.vertices.size() * GetVertexSize(format));
+		EncodeVertices(format, meshData.vertices.data(), meshData.vertices.size(), quantization, encoded.data());
+		return encoded;
+	}
+}
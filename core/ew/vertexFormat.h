@@ -0,0 +1,152 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "ewMath/ewMath.h"
+
+namespace ew {
+	struct Vertex;
+	struct MeshData;
+	class Shader;
+
+	//GPU side vertex layouts a Mesh can be uploaded in. Attribute locations stay 0 = position, 1 = normal, 2 = uv.
+	//Every format but FLOAT32 stores the normal octahedral encoded as a vec2 and expects the vertex shader to decode it,
+	//and applies VertexQuantization to positions and uvs, see SetQuantizationUniforms:
+	//	uniform vec3 _PositionOffset, _PositionScale;
+	//	uniform vec2 _UVOffset, _UVScale;
+	//	vec3 pos = _PositionOffset + vPos * _PositionScale;
+	//	vec2 uv = _UVOffset + vUV * _UVScale;
+	//	vec3 n = vec3(vNormal.xy, 1.0 - abs(vNormal.x) - abs(vNormal.y));
+	//	n.xy += mix(vec2(max(-n.z, 0.0)), vec2(-max(-n.z, 0.0)), greaterThanEqual(n.xy, vec2(0.0)));
+	//	n = normalize(n);
+	enum class VertexFormat {
+		FLOAT32 = 0, //32 bytes. ew::Vertex as is
+		HALF = 1, //16 bytes. Half float position and uv, snorm16 normal
+		SNORM16 = 2, //16 bytes. snorm16 position within the mesh bounds, snorm16 normal, unorm16 uv within the uv bounds
+		COMPACT = 3 //12 bytes. As SNORM16 with an snorm8 normal, about 1 degree of normal error
+	};
+
+	struct VertexHalf {
+		uint16_t pos[3];
+		uint16_t padding;
+		int16_t normal[2];
+		uint16_t uv[2];
+	};
+	struct VertexSnorm16 {
+		int16_t pos[3];
+		int16_t padding;
+		int16_t normal[2];
+		uint16_t uv[2];
+	};
+	struct VertexCompact {
+		int16_t pos[3];
+		int8_t normal[2];
+		uint16_t uv[2];
+	};
+	static_assert(sizeof(VertexHalf) == 16 && sizeof(VertexSnorm16) == 16 && sizeof(VertexCompact) == 12, "Vertex formats must be tightly packed");
+
+	//Size in bytes of one vertex in format
+	size_t GetVertexSize(VertexFormat format);
+
+	//Maps stored positions and uvs back to model space: pos = positionOffset + stored * positionScale.
+	//Stored values are the ones the GPU sees, i.e. snorm and unorm values are already in [-1, 1] and [0, 1]
+	struct VertexQuantization {
+		ew::Vec3 positionOffset = ew::Vec3(0.0f);
+		ew::Vec3 positionScale = ew::Vec3(1.0f);
+		ew::Vec2 uvOffset = ew::Vec2(0.0f);
+		ew::Vec2 uvScale = ew::Vec2(1.0f);
+	};
+
+	//Identity for FLOAT32 and HALF. Fits the position and uv bounds of vertices for the normalized formats
+	VertexQuantization ComputeVertexQuantization(VertexFormat format, const Vertex* vertices, size_t numVertices);
+	//Sets _PositionOffset, _PositionScale, _UVOffset and _UVScale on shader, which must be in use
+	void SetQuantizationUniforms(const Shader& shader, const VertexQuantization& quantization);
+
+	//Encodes numVertices vertices into out, which must hold numVertices * GetVertexSize(format) bytes. Runs in parallel
+	void EncodeVertices(VertexFormat format, const Vertex* vertices, size_t numVertices, const VertexQuantization& quantization, void* out);
+	std::vector<unsigned char> EncodeVertices(VertexFormat format, const MeshData& meshData, const VertexQuantization& quantization);
+
+	//IEEE half float conversion, rounding to nearest even
+	inline uint16_t FloatToHalf(float value) {
+		const uint32_t F32_INFINITY = 255u << 23;
+		const uint32_t F16_OVERFLOW = (127u + 16u) << 23;
+		const uint32_t DENORM_MAGIC = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		const uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+		uint16_t half;
+		if (bits >= F16_OVERFLOW) {
+			//Infinity or NaN
+			half = bits > F32_INFINITY ? 0x7e00 : 0x7c00;
+		}
+		else if (bits < (113u << 23)) {
+			//Subnormal half. Adding the magic number lets the FPU do the rounding
+			float magic, f;
+			memcpy(&magic, &DENORM_MAGIC, sizeof(magic));
+			memcpy(&f, &bits, sizeof(f));
+			f += magic;
+			memcpy(&bits, &f, sizeof(bits));
+			half = (uint16_t)(bits - DENORM_MAGIC);
+		}
+		else {
+			const uint32_t mantissaOdd = (bits >> 13) & 1;
+			bits += (uint32_t)(15 - 127) * (1u << 23) + 0xfff;
+			bits += mantissaOdd;
+			half = (uint16_t)(bits >> 13);
+		}
+		return half | (uint16_t)(sign >> 16);
+	}
+	inline float HalfToFloat(uint16_t half) {
+		const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+		const uint32_t exponent = (half >> 10) & 0x1f;
+		const uint32_t mantissa = half & 0x3ff;
+		if (exponent == 0) {
+			//Zero or subnormal
+			const float f = mantissa * (1.0f / (1 << 24));
+			return sign ? -f : f;
+		}
+		const uint32_t bits = sign | (exponent == 31 ? 0x7f800000u | (mantissa << 13) : ((exponent + 112) << 23) | (mantissa << 13));
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+
+	//v in [-1, 1] to a signed normalized integer with maxValue steps per side, as GL decodes it
+	inline int QuantizeSnorm(float v, int maxValue) {
+		v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+		return (int)roundf(v * maxValue);
+	}
+	//v in [0, 1] to an unsigned normalized integer
+	inline unsigned int QuantizeUnorm(float v, unsigned int maxValue) {
+		v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+		return (unsigned int)(v * maxValue + 0.5f);
+	}
+
+	//Maps a unit vector onto the octahedron unfolded into [-1, 1]^2. A zero vector maps to (0, 0), which decodes to +Z
+	inline ew::Vec2 OctEncode(const ew::Vec3& n) {
+		const float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		if (!(l1 > 0.0f)) {
+			return ew::Vec2(0.0f, 0.0f);
+		}
+		const float invL1 = 1.0f / l1;
+		float x = n.x * invL1;
+		float y = n.y * invL1;
+		if (n.z < 0.0f) {
+			const float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			const float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		return ew::Vec2(x, y);
+	}
+	inline ew::Vec3 OctDecode(const ew::Vec2& e) {
+		ew::Vec3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+		const float t = n.z < 0.0f ? -n.z : 0.0f;
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return ew::Normalize(n);
+	}
+}